@@ -0,0 +1,123 @@
+#include "rang.hpp"
+#include "rang/async.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace rang;
+
+namespace {
+
+// Stand-in for a slow target: a terminal or a pipe to a log shipper
+class slowBuf : public std::streambuf {
+public:
+    explicit slowBuf(const long nanosPerKiB) : nanosPerKiB_(nanosPerKiB) {}
+
+protected:
+    std::streamsize xsputn(const char *, const std::streamsize n) override
+    {
+        const long kib = static_cast<long>(n / 1024 + 1);
+        const auto end = std::chrono::steady_clock::now()
+          + std::chrono::nanoseconds(nanosPerKiB_ * kib);
+        while (std::chrono::steady_clock::now() < end) {
+        }
+        return n;
+    }
+
+    int_type overflow(const int_type ch) override
+    {
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    long nanosPerKiB_;
+};
+
+// Producer latencies of all threads, reported as percentiles by thread 0
+std::mutex latencyMutex;
+std::vector<double> latencies;
+
+template <typename Write>
+void measure(benchmark::State &state, Write write)
+{
+    using clock = std::chrono::steady_clock;
+    std::vector<double> own;
+    own.reserve(1 << 20);
+    const std::string text = "request handled in 3ms, 200 OK, 512 bytes\n";
+    for (auto _ : state) {
+        const clock::time_point start = clock::now();
+        write(text);
+        const clock::duration took = clock::now() - start;
+        own.push_back(std::chrono::duration<double, std::nano>(took).count());
+    }
+    std::lock_guard<std::mutex> lock(latencyMutex);
+    latencies.insert(latencies.end(), own.begin(), own.end());
+}
+
+void report(benchmark::State &state)
+{
+    std::lock_guard<std::mutex> lock(latencyMutex);
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto at = [](const double q) {
+        return latencies[static_cast<std::size_t>(q * (latencies.size() - 1))];
+    };
+    state.counters["p50_ns"]  = at(0.50);
+    state.counters["p99_ns"]  = at(0.99);
+    state.counters["p999_ns"] = at(0.999);
+    latencies.clear();
+}
+
+slowBuf target(2000);
+std::ostream targetStream(&target);
+std::unique_ptr<asyncSink> sink;
+
+void BM_Inline(benchmark::State &state)
+{
+    if (state.thread_index() == 0) {
+        setControlMode(targetStream, control::Force);
+    }
+    measure(state, [](const std::string &text) {
+        line(targetStream) << fg::red << style::bold << text;
+    });
+    if (state.thread_index() == 0) {
+        report(state);
+    }
+}
+
+void BM_Async(benchmark::State &state)
+{
+    if (state.thread_index() == 0) {
+        setControlMode(targetStream, control::Force);
+        sink.reset(new asyncSink(targetStream, 1 << 20,
+                                 static_cast<backpressure>(state.range(0))));
+    }
+    measure(state, [](const std::string &text) {
+        sink->write(fg::red | style::bold, text);
+    });
+    if (state.thread_index() == 0) {
+        sink.reset();
+        report(state);
+    }
+}
+
+}  // namespace
+
+// Inline rang::line writes against the async sink, argument is the
+// backpressure policy: 0 = Block, 1 = Drop, 2 = Overwrite
+BENCHMARK(BM_Inline)->Threads(1)->Threads(4)->UseRealTime();
+BENCHMARK(BM_Async)
+  ->Arg(0)
+  ->Arg(1)
+  ->Arg(2)
+  ->Threads(1)
+  ->Threads(4)
+  ->UseRealTime();
+
+BENCHMARK_MAIN();
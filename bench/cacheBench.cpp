@@ -0,0 +1,97 @@
+#include "rang.hpp"
+#include <benchmark/benchmark.h>
+#include <sstream>
+
+using namespace rang;
+
+namespace {
+
+// How operator<< decided before the per-stream cache: control mode,
+// supportsColor and the rdbuf comparisons of isTerminal on every insertion
+template <typename T>
+std::ostream &uncachedInsert(std::ostream &os, const T &value)
+{
+    namespace impl = rang_implementation;
+    switch (impl::controlMode().load()) {
+        case control::Auto:
+            return impl::supportsColor() && impl::isTerminal(os.rdbuf())
+              ? impl::setColor(os, value)
+              : os;
+        case control::Force: return impl::setColor(os, value);
+        default: return os;
+    }
+}
+
+// Rewinds the stream now and then so Force runs don't measure reallocation
+void rewind(std::ostringstream &os, const std::size_t i)
+{
+    if ((i & 0xFFF) == 0) {
+        os.seekp(0);
+    }
+}
+
+template <typename Insert>
+void runInsertions(benchmark::State &state, const control mode, Insert insert)
+{
+    setControlMode(mode);
+    std::ostringstream os;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        insert(os);
+        rewind(os, ++i);
+    }
+    setControlMode(control::Auto);
+}
+
+void BM_Uncached(benchmark::State &state)
+{
+    runInsertions(state, static_cast<control>(state.range(0)),
+                  [](std::ostream &os) { uncachedInsert(os, fg::red); });
+}
+
+void BM_Cached(benchmark::State &state)
+{
+    runInsertions(state, static_cast<control>(state.range(0)),
+                  [](std::ostream &os) { os << fg::red; });
+}
+
+// Decision alone, without writing anything
+void BM_DecisionUncached(benchmark::State &state)
+{
+    setControlMode(control::Auto);
+    std::ostringstream os;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+          rang_implementation::decideColorize(os.rdbuf(), control::Auto));
+    }
+}
+
+void BM_DecisionCached(benchmark::State &state)
+{
+    setControlMode(control::Auto);
+    std::ostringstream os;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rang_implementation::shouldColorize(os));
+    }
+}
+
+// Stream with its own control mode, the global epoch isn't read
+void BM_DecisionOverride(benchmark::State &state)
+{
+    std::ostringstream os;
+    setControlMode(os, control::Force);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rang_implementation::shouldColorize(os));
+    }
+}
+
+}  // namespace
+
+// Argument is the control mode: 0 = Off, 1 = Auto, 2 = Force
+BENCHMARK(BM_Uncached)->Arg(0)->Arg(1)->Arg(2);
+BENCHMARK(BM_Cached)->Arg(0)->Arg(1)->Arg(2);
+BENCHMARK(BM_DecisionUncached);
+BENCHMARK(BM_DecisionCached)->ThreadRange(1, 8);
+BENCHMARK(BM_DecisionOverride)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
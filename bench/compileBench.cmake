@@ -0,0 +1,115 @@
+# Compile time of rang's headers: writes TUS translation units per variant,
+# each including one header and using it a little, compiles them one after
+# another and reports the preprocessed size and the time per unit.
+#
+#   cmake --build build --target compileBench
+#
+# or standalone, with a GCC or Clang compatible compiler:
+#
+#   cmake -DCXX=g++ -DINCLUDE_DIR=include -DWORK_DIR=/tmp/rang-compile \
+#         -DTUS=50 -P bench/compileBench.cmake
+
+cmake_minimum_required(VERSION 3.10)
+
+foreach(var CXX INCLUDE_DIR WORK_DIR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "compileBench.cmake needs -D${var}=...")
+    endif()
+endforeach()
+if(NOT DEFINED TUS)
+    set(TUS 50)
+endif()
+if(NOT DEFINED STD)
+    set(STD c++11)
+endif()
+
+# Sub-second timestamps need CMake 3.23, fall back to whole seconds
+if(CMAKE_VERSION VERSION_LESS 3.23)
+    set(stamp_format "%s")
+    set(stamp_scale 1000)
+else()
+    set(stamp_format "%s%f")
+    set(stamp_scale 1)
+endif()
+
+function(now_ms out)
+    string(TIMESTAMP stamp "${stamp_format}" UTC)
+    if(stamp_scale EQUAL 1)
+        # %s%f is microseconds
+        string(LENGTH "${stamp}" length)
+        math(EXPR length "${length} - 3")
+        string(SUBSTRING "${stamp}" 0 ${length} stamp)
+    else()
+        math(EXPR stamp "${stamp} * ${stamp_scale}")
+    endif()
+    set(${out} ${stamp} PARENT_SCOPE)
+endfunction()
+
+# Code using the header, kept out of the list below because of its ';'
+set(base_use "void use(std::ostream &os) { os << 'x'; }")
+set(stream_use "void use(std::ostream &os) { os << rang::fg::red << \"x\" << rang::style::reset; }")
+set(core_use "bool use(int fd) { return rang::writeStyle(fd, rang::fg::red); }")
+set(fwd_use "rang::fg use() { return rang::fg::red; }")
+
+# name|header|extra flags|code using it
+set(variants
+    "baseline <ostream>|ostream||base"
+    "rang.hpp|rang.hpp||stream"
+    "rang/ostream.hpp|rang/ostream.hpp||stream"
+    "rang/ostream.hpp compiled|rang/ostream.hpp|-DRANG_COMPILED|stream"
+    "rang/core.hpp|rang/core.hpp||core"
+    "rang/core.hpp compiled|rang/core.hpp|-DRANG_COMPILED|core"
+    "rang/fwd.hpp|rang/fwd.hpp||fwd")
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+set(report "")
+set(index 0)
+foreach(variant IN LISTS variants)
+    string(REPLACE "|" ";" fields "${variant}")
+    list(GET fields 0 name)
+    list(GET fields 1 header)
+    list(GET fields 2 flags)
+    list(GET fields 3 use)
+    set(code "${${use}_use}")
+    separate_arguments(flags)
+
+    set(dir "${WORK_DIR}/variant${index}")
+    file(MAKE_DIRECTORY "${dir}")
+    math(EXPR last "${TUS} - 1")
+    foreach(i RANGE ${last})
+        file(WRITE "${dir}/tu${i}.cpp"
+             "#include <${header}>\nnamespace tu${i} {\n${code}\n}\n")
+    endforeach()
+
+    execute_process(
+        COMMAND "${CXX}" -std=${STD} ${flags} "-I${INCLUDE_DIR}" -E -P
+                "${dir}/tu0.cpp"
+        OUTPUT_VARIABLE preprocessed
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Preprocessing ${name} failed")
+    endif()
+    string(REGEX MATCHALL "\n" newlines "${preprocessed}")
+    list(LENGTH newlines lines)
+
+    now_ms(start)
+    foreach(i RANGE ${last})
+        execute_process(
+            COMMAND "${CXX}" -std=${STD} ${flags} "-I${INCLUDE_DIR}" -c
+                    "${dir}/tu${i}.cpp" -o "${dir}/tu${i}.o"
+            RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "Compiling ${name} failed")
+        endif()
+    endforeach()
+    now_ms(end)
+
+    math(EXPR total "${end} - ${start}")
+    math(EXPR per_tu "${total} / ${TUS}")
+    string(APPEND report
+           "  ${name}: ${lines} preprocessed lines, ${per_tu} ms per TU\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+message("Compile time over ${TUS} translation units (${CXX}, -std=${STD})\n"
+        "${report}")
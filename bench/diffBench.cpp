@@ -0,0 +1,116 @@
+#include "rang/diff.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+using namespace rang;
+
+namespace {
+
+// Copies everything into a fixed buffer, like a fast stdio sink would
+class copyBuf : public std::streambuf {
+protected:
+    std::streamsize xsputn(const char *s, const std::streamsize n) override
+    {
+        const std::size_t size = static_cast<std::size_t>(n);
+        for (std::size_t done = 0; done < size;) {
+            const std::size_t chunk = std::min(size - done, sizeof data_);
+            std::memcpy(data_, s + done, chunk);
+            benchmark::ClobberMemory();
+            done += chunk;
+        }
+        return n;
+    }
+
+    int_type overflow(const int_type ch) override
+    {
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    char data_[4096];
+};
+
+/* A config like file of lines lines and a copy with every perMille/1000th
+ * line changed, removed or followed by a new one.
+ */
+void makeFiles(const std::size_t lines, const unsigned perMille,
+               std::string &from, std::string &to)
+{
+    std::mt19937 random(42);
+    from.clear();
+    to.clear();
+    for (std::size_t i = 0; i < lines; ++i) {
+        const std::string line = "service" + std::to_string(i % 97)
+          + ".replicas[" + std::to_string(i) + "] = "
+          + std::to_string(random() % 1000) + "  # zone eu-west\n";
+        from += line;
+        if (random() % 1000 >= perMille) {
+            to += line;
+            continue;
+        }
+        switch (random() % 3) {
+            case 0: to += "service.new = " + line; break;
+            case 1: break;
+            default: to += line + "service.extra = true\n"; break;
+        }
+    }
+}
+
+void Diff(benchmark::State &state, const control mode)
+{
+    std::string from;
+    std::string to;
+    makeFiles(static_cast<std::size_t>(state.range(0)),
+              static_cast<unsigned>(state.range(1)), from, to);
+    copyBuf target;
+    std::ostream out(&target);
+    setControlMode(mode);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+          diff(out, from.data(), from.size(), to.data(), to.size()));
+    }
+    setControlMode(control::Auto);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                            * static_cast<int64_t>(from.size() + to.size()));
+}
+
+// The same through diffFiles, mapping files written once
+void DiffFiles(benchmark::State &state)
+{
+    std::string from;
+    std::string to;
+    makeFiles(static_cast<std::size_t>(state.range(0)),
+              static_cast<unsigned>(state.range(1)), from, to);
+    std::ofstream("diffBench.from") << from;
+    std::ofstream("diffBench.to") << to;
+    copyBuf target;
+    std::ostream out(&target);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+          diffFiles(out, "diffBench.from", "diffBench.to"));
+    }
+    std::remove("diffBench.from");
+    std::remove("diffBench.to");
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                            * static_cast<int64_t>(from.size() + to.size()));
+}
+
+}  // namespace
+
+// Arguments: lines, changed lines per 1000; 1M lines is about 55 MB
+BENCHMARK_CAPTURE(Diff, Off, control::Off)
+  ->Args({ 100000, 1 })
+  ->Args({ 100000, 100 })
+  ->Args({ 1000000, 1 })
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(Diff, Force, control::Force)
+  ->Args({ 100000, 1 })
+  ->Args({ 100000, 100 })
+  ->Args({ 1000000, 1 })
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(DiffFiles)->Args({ 1000000, 1 })->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,95 @@
+#include "rang/highlight.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+
+using namespace rang;
+
+namespace {
+
+// Copies everything into a fixed buffer, like a fast stdio sink would
+class copyBuf : public std::streambuf {
+protected:
+    std::streamsize xsputn(const char *s, const std::streamsize n) override
+    {
+        const std::size_t size = static_cast<std::size_t>(n);
+        for (std::size_t done = 0; done < size;) {
+            const std::size_t chunk = std::min(size - done, sizeof data_);
+            std::memcpy(data_, s + done, chunk);
+            benchmark::ClobberMemory();
+            done += chunk;
+        }
+        return n;
+    }
+
+    int_type overflow(const int_type ch) override
+    {
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    char data_[4096];
+};
+
+// About 4 MiB of input in each syntax
+std::string makeInput(const syntax lang)
+{
+    static const char *const pieces[] = {
+        "{\"id\": 1042, \"name\": \"worker-7\", \"load\": 0.97, \"tags\": "
+        "[\"db\", \"eu-west\"], \"healthy\": true, \"owner\": null}\n",
+        "ts=2024-01-01T12:00:00Z level=error worker=42 took=3.5ms "
+        "msg=\"disk full\" retry=false path=/var/lib/data\n",
+        "static int count(const char *p, int n) { // bytes below 0x80\n"
+        "    int k = 0; for (int i = 0; i < n; ++i) { k += p[i] >= 0; }\n"
+        "    return k; /* done */ }\n"
+    };
+    const std::string piece = pieces[static_cast<int>(lang)];
+    std::string text;
+    text.reserve((4u << 20) + piece.size());
+    while (text.size() < (4u << 20)) {
+        text += piece;
+    }
+    return text;
+}
+
+void Highlight(benchmark::State &state, const syntax lang, const control mode)
+{
+    const std::string text = makeInput(lang);
+    copyBuf target;
+    std::ostream out(&target);
+    setControlMode(mode);
+    for (auto _ : state) {
+        highlight(out, lang, text.data(), text.size());
+    }
+    setControlMode(control::Auto);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                            * static_cast<int64_t>(text.size()));
+}
+
+// Tokens alone, without escapes or output
+void Tokenize(benchmark::State &state, const syntax lang)
+{
+    const std::string text = makeInput(lang);
+    for (auto _ : state) {
+        std::size_t tokens = 0;
+        tokenize(lang, text.data(), text.size(),
+                 [&tokens](token, const char *, std::size_t) { ++tokens; });
+        benchmark::DoNotOptimize(tokens);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                            * static_cast<int64_t>(text.size()));
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(Tokenize, json, syntax::json);
+BENCHMARK_CAPTURE(Tokenize, keyValue, syntax::keyValue);
+BENCHMARK_CAPTURE(Tokenize, cLike, syntax::cLike);
+BENCHMARK_CAPTURE(Highlight, json/Off, syntax::json, control::Off);
+BENCHMARK_CAPTURE(Highlight, json/Force, syntax::json, control::Force);
+BENCHMARK_CAPTURE(Highlight, keyValue/Off, syntax::keyValue, control::Off);
+BENCHMARK_CAPTURE(Highlight, keyValue/Force, syntax::keyValue,
+                  control::Force);
+BENCHMARK_CAPTURE(Highlight, cLike/Off, syntax::cLike, control::Off);
+BENCHMARK_CAPTURE(Highlight, cLike/Force, syntax::cLike, control::Force);
+
+BENCHMARK_MAIN();
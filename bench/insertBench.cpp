@@ -0,0 +1,261 @@
+#include "rang.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#if defined(__unix__) || defined(__unix) || defined(__linux__)                 \
+  || defined(__APPLE__)
+#define BENCH_PTY
+#include <chrono>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+using namespace rang;
+
+// Allocation counting #########################################################
+
+namespace {
+std::atomic<std::size_t> allocations(0);
+}
+
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size != 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Pseudo terminal on stderr for control::Auto with a real TTY #################
+
+#ifdef BENCH_PTY
+std::atomic<std::size_t> ptyBytes(0);
+
+// Makes fd 2 the slave side of a new pty and drains the master in the
+// background, must run before rang first looks at std::cerr
+bool attachPty()
+{
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        return false;
+    }
+    const char *name = ptsname(master);
+    const int slave  = name != nullptr ? open(name, O_RDWR | O_NOCTTY) : -1;
+    if (slave < 0 || dup2(slave, STDERR_FILENO) < 0) {
+        return false;
+    }
+    close(slave);
+    std::thread([master] {
+        char buf[4096];
+        for (;;) {
+            const ssize_t n = read(master, buf, sizeof buf);
+            if (n <= 0) {
+                return;
+            }
+            ptyBytes.fetch_add(static_cast<std::size_t>(n));
+        }
+    }).detach();
+    return true;
+}
+
+// Bytes written to the pty so far, once the drain thread has caught up
+std::size_t drainedPtyBytes()
+{
+    std::size_t seen = ptyBytes.load();
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const std::size_t now = ptyBytes.load();
+        if (now == seen) {
+            return now;
+        }
+        seen = now;
+    }
+}
+#endif
+
+// Output targets ##############################################################
+
+enum class sinkKind { stringStream, fileStream, redirectedCout, pty };
+
+const char *const fileName = "rang_insertBench.out";
+
+class sink {
+public:
+    explicit sink(const sinkKind kind) : kind_(kind), written_(0)
+    {
+        if (kind_ == sinkKind::fileStream || kind_ == sinkKind::redirectedCout) {
+            file_.open(fileName, std::ios::out | std::ios::trunc);
+        }
+        if (kind_ == sinkKind::redirectedCout) {
+            coutBuf_ = std::cout.rdbuf(file_.rdbuf());
+        }
+#ifdef BENCH_PTY
+        if (kind_ == sinkKind::pty) {
+            ptyStart_ = drainedPtyBytes();
+        }
+#endif
+    }
+
+    ~sink()
+    {
+        if (kind_ == sinkKind::redirectedCout) {
+            std::cout.rdbuf(coutBuf_);
+        }
+        if (file_.is_open()) {
+            file_.close();
+            std::remove(fileName);
+        }
+    }
+
+    std::ostream &stream()
+    {
+        switch (kind_) {
+            case sinkKind::stringStream: return string_;
+            case sinkKind::fileStream: return file_;
+            case sinkKind::redirectedCout: return std::cout;
+            default: return std::cerr;
+        }
+    }
+
+    // Counts what was written and rewinds, so buffers and files stay small
+    void rewind()
+    {
+        std::ostream &os = stream();
+        if (kind_ != sinkKind::pty) {
+            written_ += static_cast<std::size_t>(os.tellp());
+            os.seekp(0);
+        }
+    }
+
+    std::size_t bytes()
+    {
+        rewind();
+#ifdef BENCH_PTY
+        if (kind_ == sinkKind::pty) {
+            std::cerr.flush();
+            return drainedPtyBytes() - ptyStart_;
+        }
+#endif
+        return written_;
+    }
+
+private:
+    sinkKind kind_;
+    std::size_t written_;
+    std::ostringstream string_;
+    std::ofstream file_;
+    std::streambuf *coutBuf_ = nullptr;
+#ifdef BENCH_PTY
+    std::size_t ptyStart_ = 0;
+#endif
+};
+
+// Benchmarks ##################################################################
+
+template <typename T>
+void insertion(benchmark::State &state, const control mode, const sinkKind kind,
+               const T value)
+{
+    sink out(kind);
+    std::ostream &os = out.stream();
+    setControlMode(mode);
+
+    std::size_t i            = 0;
+    const std::size_t before = allocations.load();
+    for (auto _ : state) {
+        os << value;
+        if ((++i & 0xFFF) == 0) {
+            out.rewind();
+        }
+    }
+    const std::size_t allocs = allocations.load() - before;
+
+    const std::size_t bytes = out.bytes();
+    setControlMode(control::Auto);
+
+    using counter = benchmark::Counter;
+
+    state.counters["bytes/op"]  = counter(static_cast<double>(bytes),
+                                         counter::kAvgIterations);
+    state.counters["allocs/op"] = counter(static_cast<double>(allocs),
+                                          counter::kAvgIterations);
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+const char *modeName(const control mode)
+{
+    switch (mode) {
+        case control::Off: return "Off";
+        case control::Auto: return "Auto";
+        default: return "Force";
+    }
+}
+
+const char *sinkName(const sinkKind kind)
+{
+    switch (kind) {
+        case sinkKind::stringStream: return "ostringstream";
+        case sinkKind::fileStream: return "ofstream";
+        case sinkKind::redirectedCout: return "redirected_cout";
+        default: return "pty_cerr";
+    }
+}
+
+template <typename T>
+void registerValue(const char *valueName, const T value, const bool withPty)
+{
+    const control modes[]  = { control::Off, control::Auto, control::Force };
+    const sinkKind sinks[] = { sinkKind::stringStream, sinkKind::fileStream,
+                               sinkKind::redirectedCout, sinkKind::pty };
+    for (const control mode : modes) {
+        for (const sinkKind kind : sinks) {
+            if (kind == sinkKind::pty && !withPty) {
+                continue;
+            }
+            const std::string name = std::string("Insert/") + valueName + '/'
+              + modeName(mode) + '/' + sinkName(kind);
+            benchmark::RegisterBenchmark(
+              name.c_str(), [=](benchmark::State &state) {
+                  insertion(state, mode, kind, value);
+              });
+        }
+    }
+}
+
+}  // namespace
+
+// ./insertBench --benchmark_filter=Auto/pty
+int main(int argc, char **argv)
+{
+#ifdef BENCH_PTY
+    const bool withPty = attachPty();
+#else
+    const bool withPty = false;
+#endif
+
+    registerValue("style", style::bold, withPty);
+    registerValue("fg", fg::red, withPty);
+    registerValue("bg", bg::red, withPty);
+    registerValue("fgB", fgB::red, withPty);
+    registerValue("bgB", bgB::red, withPty);
+    registerValue("styleSet", style::bold | fg::red | bg::black, withPty);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+}
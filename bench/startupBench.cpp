@@ -0,0 +1,160 @@
+#include "rang.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__unix__) || defined(__unix) || defined(__linux__)                 \
+  || defined(__APPLE__)
+#define BENCH_SPAWN
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+using namespace rang;
+
+/* Process start to first colored byte: the benchmark starts this same
+ * executable as a child with a pty on its stdout and times until the
+ * child's colored output arrives. The child writes it after
+ *   none:    plain write(2), no rang at all, the cost of the process
+ *   lazy:    rang probing on first use
+ *   init:    rang::init probing everything up front
+ *   inherit: rang::init taking the parent's RANG_ENVIRONMENT
+ */
+
+namespace {
+
+// What init spends when it probes and when it inherits
+void probe(benchmark::State &state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(probeEnvironment());
+    }
+}
+BENCHMARK(probe);
+
+void inherit(benchmark::State &state)
+{
+    environment env;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseEnvironment("3011", env));
+    }
+}
+BENCHMARK(inherit);
+
+#ifdef BENCH_SPAWN
+const char *const childFlag = "--startup-child";
+
+const char *selfPath = nullptr;
+
+int runChild(const char *mode)
+{
+    if (std::strcmp(mode, "none") == 0) {
+        static const char text[] = "\033[32mok\033[0m";
+        return write(1, text, sizeof text - 1) > 0 ? 0 : 1;
+    }
+    if (std::strcmp(mode, "lazy") != 0) {
+        rang::init();
+    }
+    std::cout << fg::green << "ok" << style::reset << std::flush;
+    return std::cout ? 0 : 1;
+}
+
+// The child's output up to its "ok", or all of it if it fails
+std::string readFirstOutput(const int master)
+{
+    std::string out;
+    char buf[256];
+    while (out.find("ok") == std::string::npos) {
+        const ssize_t n = read(master, buf, sizeof buf);
+        if (n <= 0) {
+            break;
+        }
+        out.append(buf, static_cast<std::size_t>(n));
+    }
+    return out;
+}
+
+void startup(benchmark::State &state, const char *mode)
+{
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        state.SkipWithError("no pseudo terminal");
+        return;
+    }
+    const char *name = ptsname(master);
+    const int slave  = name != nullptr ? open(name, O_RDWR | O_NOCTTY) : -1;
+    if (slave < 0) {
+        close(master);
+        state.SkipWithError("no pseudo terminal");
+        return;
+    }
+
+    // What a parent handing its pty to the child would export
+    if (std::strcmp(mode, "inherit") == 0) {
+        environment env = probeEnvironment();
+        env.terminal[1] = true;
+        exportEnvironment(env);
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, slave, 1);
+    posix_spawn_file_actions_addclose(&actions, master);
+    char *const argv[] = { const_cast<char *>(selfPath),
+                           const_cast<char *>(childFlag),
+                           const_cast<char *>(mode), nullptr };
+
+    std::string out;
+    for (auto _ : state) {
+        pid_t pid = 0;
+        if (posix_spawn(&pid, selfPath, &actions, nullptr, argv, environ)
+            != 0) {
+            state.SkipWithError("posix_spawn failed");
+            break;
+        }
+        out = readFirstOutput(master);
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+    if (out.compare(0, 1, "\033") != 0) {
+        state.SkipWithError("the child wrote no escapes, check TERM");
+    }
+
+    unsetenv("RANG_ENVIRONMENT");
+    posix_spawn_file_actions_destroy(&actions);
+    close(slave);
+    close(master);
+}
+
+BENCHMARK_CAPTURE(startup, none, "none")->UseRealTime();
+BENCHMARK_CAPTURE(startup, lazy, "lazy")->UseRealTime();
+BENCHMARK_CAPTURE(startup, init, "init")->UseRealTime();
+BENCHMARK_CAPTURE(startup, inherit, "inherit")->UseRealTime();
+#endif
+
+}  // namespace
+
+// ./startupBench --benchmark_filter=startup/inherit
+int main(int argc, char **argv)
+{
+#ifdef BENCH_SPAWN
+    if (argc == 3 && std::strcmp(argv[1], childFlag) == 0) {
+        return runChild(argv[2]);
+    }
+    selfPath = argv[0];
+    unsetenv("RANG_ENVIRONMENT");
+    // The children look at TERM like any colored tool would
+    setenv("TERM", "xterm-256color", 0);
+#endif
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,84 @@
+#include "rang.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+
+using namespace rang;
+
+namespace {
+
+// Copies everything into a fixed buffer, like a fast stdio sink would
+class copyBuf : public std::streambuf {
+protected:
+    std::streamsize xsputn(const char *s, const std::streamsize n) override
+    {
+        const std::size_t size = static_cast<std::size_t>(n);
+        for (std::size_t done = 0; done < size;) {
+            const std::size_t chunk = std::min(size - done, sizeof data_);
+            std::memcpy(data_, s + done, chunk);
+            benchmark::ClobberMemory();
+            done += chunk;
+        }
+        return n;
+    }
+
+    int_type overflow(const int_type ch) override
+    {
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    char data_[4096];
+};
+
+// Log lines, every `colored` one of them wrapped in SGR escapes
+std::string makeText(const std::size_t lines, const std::size_t colored)
+{
+    std::string text;
+    for (std::size_t i = 0; i < lines; ++i) {
+        const bool color = colored != 0 && i % colored == 0;
+        if (color) {
+            text += "\033[1;31m";
+        }
+        text += "2024-01-01 12:00:00 worker[42] request handled in 3ms";
+        if (color) {
+            text += "\033[0m";
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+void runWrites(benchmark::State &state, std::streambuf &buf,
+               const std::string &text)
+{
+    const std::streamsize size = static_cast<std::streamsize>(text.size());
+    for (auto _ : state) {
+        buf.sputn(text.data(), size);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                            * static_cast<int64_t>(text.size()));
+}
+
+// Target alone, the memcpy speed stripping is measured against
+void BM_Direct(benchmark::State &state)
+{
+    copyBuf target;
+    runWrites(state, target,
+              makeText(256, static_cast<std::size_t>(state.range(0))));
+}
+
+void BM_Strip(benchmark::State &state)
+{
+    copyBuf target;
+    stripbuf buf(&target, control::Off);
+    runWrites(state, buf,
+              makeText(256, static_cast<std::size_t>(state.range(0))));
+}
+
+}  // namespace
+
+// Argument: every n-th line is colored, 0 = plain text
+BENCHMARK(BM_Direct)->Arg(0)->Arg(8)->Arg(1);
+BENCHMARK(BM_Strip)->Arg(0)->Arg(8)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,87 @@
+#include "rang/width.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+
+using namespace rang;
+
+namespace {
+
+// A log line, its level colored with SGR escapes or not
+std::string makeLine(const bool colored, const bool wide)
+{
+    std::string line = "2024-01-01 12:00:00 worker[42] ";
+    line += colored ? "\033[1;31mERROR\033[0m" : "ERROR";
+    line += wide ? " \xE8\xAF\xB7\xE6\xB1\x82\xE5\xA4\xB1\xE8\xB4\xA5"
+                 : " request failed";
+    line += " after 3ms on /api/v1/items";
+    return line;
+}
+
+// A byte at a time, what visibleWidth does without memchr and words
+std::size_t bytewiseWidth(const std::string &text)
+{
+    namespace impl = rang_implementation;
+    const unsigned char *p
+      = reinterpret_cast<const unsigned char *>(text.data());
+    const unsigned char *end = p + text.size();
+    std::size_t width        = 0;
+    while (p != end) {
+        if (*p == 0x1B) {
+            p += impl::escapeLength(p, end);
+        } else {
+            std::size_t length;
+            width += impl::charWidth(p, end, length);
+            p += length;
+        }
+    }
+    return width;
+}
+
+void runLines(benchmark::State &state, const std::string &line)
+{
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                            * static_cast<int64_t>(line.size()));
+}
+
+void Width(benchmark::State &state, const bool colored, const bool wide)
+{
+    const std::string line = makeLine(colored, wide);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(visibleWidth(line.data(), line.size()));
+    }
+    runLines(state, line);
+}
+BENCHMARK_CAPTURE(Width, plain, false, false);
+BENCHMARK_CAPTURE(Width, colored, true, false);
+BENCHMARK_CAPTURE(Width, wide, true, true);
+
+void Bytewise(benchmark::State &state, const bool colored, const bool wide)
+{
+    const std::string line = makeLine(colored, wide);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bytewiseWidth(line));
+    }
+    runLines(state, line);
+}
+BENCHMARK_CAPTURE(Bytewise, plain, false, false);
+BENCHMARK_CAPTURE(Bytewise, colored, true, false);
+BENCHMARK_CAPTURE(Bytewise, wide, true, true);
+
+// Cutting and padding a colored line into a 40 column field
+void Fit(benchmark::State &state)
+{
+    const std::string line = makeLine(true, false);
+    char buf[128];
+    for (auto _ : state) {
+        const std::size_t size = truncateVisible(line.data(), line.size(), 40);
+        benchmark::DoNotOptimize(
+          padVisible(buf, sizeof buf, line.data(), size, 40));
+        benchmark::ClobberMemory();
+    }
+    runLines(state, line);
+}
+BENCHMARK(Fit);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,579 @@
+#ifndef RANG_ASYNC_DOT_HPP
+#define RANG_ASYNC_DOT_HPP
+
+#include "ostream.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#endif
+
+namespace rang {
+
+enum class backpressure {  // What asyncSink::write does when a ring is full
+    Block     = 0,  // (Default) wait for the writer thread to make room
+    Drop      = 1,  // discard the new record
+    Overwrite = 2  // discard the oldest records still waiting
+};
+
+namespace rang_implementation {
+
+    /* Single producer single consumer ring of records, one per thread and
+     * sink. Positions only grow, head has busyBit set while the consumer
+     * reads the record at it, which keeps Overwrite producers from
+     * discarding that record. A record is a recordHeader, the SGR codes of
+     * its style and its text, padded to 8 bytes; a header with padSize
+     * skips the rest of the buffer so records never wrap. A ring is
+     * retired when its thread exits and closed when its sink goes away.
+     */
+    class recordRing {
+    public:
+        static constexpr std::uint64_t busyBit = std::uint64_t(1) << 63;
+        static constexpr std::uint32_t padSize = 0xFFFFFFFF;
+
+        struct recordHeader {
+            std::uint32_t size;
+            std::uint8_t count;
+            std::uint8_t unused[3];
+        };
+
+        explicit recordRing(const std::size_t capacity)
+            : buffer_(capacity)
+            , mask_(capacity - 1)
+            , padding_(0)
+            , head_(0)
+            , tail_(0)
+            , retired_(false)
+            , closed_(false)
+        {
+        }
+
+        std::size_t capacity() const noexcept { return buffer_.size(); }
+
+        static std::size_t span(const std::size_t count,
+                                const std::size_t size) noexcept
+        {
+            return (sizeof(recordHeader) + count + size + 7) & ~std::size_t(7);
+        }
+
+        bool empty() const noexcept
+        {
+            return (head_.load(std::memory_order_acquire) & ~busyBit)
+              == tail_.load(std::memory_order_acquire);
+        }
+
+        /* Room for a record of the given span at the producer's end, after
+         * discarding old records if overwrite is set. Returns the offset
+         * of the record or -1 if there is no room.
+         */
+        long reserve(const std::size_t need, const bool overwrite,
+                     std::uint64_t &discarded) noexcept
+        {
+            const std::uint64_t tail  = tail_.load(std::memory_order_relaxed);
+            const std::size_t offset  = static_cast<std::size_t>(tail & mask_);
+            const std::size_t padding = capacity() - offset < need
+              ? capacity() - offset
+              : 0;
+            for (;;) {
+                std::uint64_t head = head_.load(std::memory_order_acquire);
+                if (tail + padding + need - (head & ~busyBit) <= capacity()) {
+                    break;
+                }
+                if (!overwrite) {
+                    return -1;
+                }
+                if ((head & busyBit) != 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                const std::size_t skip = recordSpan(head);
+                if (head_.compare_exchange_weak(head, head + skip,
+                                                std::memory_order_acq_rel)
+                    && !isPadding(head)) {
+                    ++discarded;
+                }
+            }
+            padding_ = padding;
+            if (padding != 0) {
+                recordHeader pad = { padSize, 0, { 0, 0, 0 } };
+                std::memcpy(&buffer_[offset], &pad, sizeof pad);
+                return 0;
+            }
+            return static_cast<long>(offset);
+        }
+
+        void retire() noexcept { retired_.store(true); }
+        bool retired() const noexcept { return retired_.load(); }
+        void close() noexcept { closed_.store(true); }
+        bool closed() const noexcept { return closed_.load(); }
+
+        char *at(const long offset) noexcept { return &buffer_[offset]; }
+
+        // Makes the reserved record, and the padding before it, readable
+        void publish(const std::size_t span) noexcept
+        {
+            tail_.store(tail_.load(std::memory_order_relaxed) + padding_ + span,
+                        std::memory_order_release);
+        }
+
+        /* Hands the oldest record to read(header, codes, text) and frees
+         * it. Returns false if the ring is empty.
+         */
+        template <typename Read>
+        bool consume(Read &&read)
+        {
+            for (;;) {
+                std::uint64_t head = head_.load(std::memory_order_acquire);
+                if (head == tail_.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                if (!head_.compare_exchange_weak(head, head | busyBit,
+                                                 std::memory_order_acquire)) {
+                    continue;  // a producer discarded it
+                }
+                const std::size_t skip = recordSpan(head);
+                if (!isPadding(head)) {
+                    const char *record = &buffer_[head & mask_];
+                    recordHeader header;
+                    std::memcpy(&header, record, sizeof header);
+                    const unsigned char *codes
+                      = reinterpret_cast<const unsigned char *>(record)
+                      + sizeof header;
+                    read(header, codes,
+                         reinterpret_cast<const char *>(codes) + header.count);
+                }
+                head_.store(head + skip, std::memory_order_release);
+                return true;
+            }
+        }
+
+    private:
+        bool isPadding(const std::uint64_t position) const noexcept
+        {
+            std::uint32_t size;
+            std::memcpy(&size, &buffer_[position & mask_], sizeof size);
+            return size == padSize;
+        }
+
+        std::size_t recordSpan(const std::uint64_t position) const noexcept
+        {
+            recordHeader header;
+            std::memcpy(&header, &buffer_[position & mask_], sizeof header);
+            return header.size == padSize
+              ? capacity() - static_cast<std::size_t>(position & mask_)
+              : span(header.count, header.size);
+        }
+
+        std::vector<char> buffer_;
+        std::size_t mask_;
+        std::size_t padding_;  // in front of the reserved record
+        // Producer and consumer positions on separate cache lines
+        char pad0_[64];
+        std::atomic<std::uint64_t> head_;
+        char pad1_[64];
+        std::atomic<std::uint64_t> tail_;
+        char pad2_[64];
+        std::atomic<bool> retired_;  // no more records will come
+        std::atomic<bool> closed_;   // nothing reads the records anymore
+    };
+
+    inline std::atomic<std::uint64_t> &sinkIds() noexcept
+    {
+        static std::atomic<std::uint64_t> next(1);
+        return next;
+    }
+
+    // A ring this thread writes to, by sink id (ids are never reused)
+    struct ringCache {
+        std::uint64_t sink;
+        std::shared_ptr<recordRing> ring;
+    };
+
+    // The rings of a thread, retired when it exits so sinks free them
+    struct threadRingList {
+        std::vector<ringCache> rings;
+
+        ~threadRingList()
+        {
+            for (const ringCache &entry : rings) {
+                entry.ring->retire();
+            }
+        }
+    };
+
+    inline std::vector<ringCache> &threadRings()
+    {
+        static thread_local threadRingList list;
+        return list.rings;
+    }
+
+}  // namespace rang_implementation
+
+/* Colored logging without formatting or writing on the calling thread:
+ *
+ *   rang::asyncSink log(std::cerr);
+ *   log.write(rang::fg::red | rang::style::bold, "disk full");
+ *
+ * write copies the style and text into a ring owned by the calling thread
+ * (ringCapacity bytes, rounded up to a power of two) and returns. A
+ * background thread drains all rings, decides once per batch whether os
+ * gets colors, as operator<< would, and writes the records, each followed
+ * by a reset, in large chunks. Records of one thread keep their order,
+ * records of different threads are not ordered. Nothing else may write to
+ * os while the sink exists; the destructor writes what is left.
+ */
+class asyncSink {
+public:
+    explicit asyncSink(std::ostream &os, const std::size_t ringCapacity = 65536,
+                       const backpressure policy = backpressure::Block)
+        : os_(os)
+        , id_(rang_implementation::sinkIds().fetch_add(1))
+        , capacity_(roundCapacity(ringCapacity))
+        , policy_(policy)
+        , dropped_(0)
+        , ringVersion_(0)
+        , snapshotVersion_(0)
+        , sleeping_(false)
+        , stop_(false)
+        , flushRequests_(0)
+        , flushed_(0)
+    {
+        writer_ = std::thread([this] { run(); });
+    }
+
+    asyncSink(const asyncSink &) = delete;
+    asyncSink &operator=(const asyncSink &) = delete;
+
+    ~asyncSink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.store(true);
+        }
+        wake_.notify_one();
+        writer_.join();
+        // Threads drop the rings of a closed sink when they next add one
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        for (const std::shared_ptr<recordRing> &ring : rings_) {
+            ring->close();
+        }
+    }
+
+    /* Queues text in the given style, false if (part of) it was dropped
+     * because of backpressure::Drop. Text longer than half a ring is
+     * queued in pieces.
+     */
+    bool write(const styleSet &style, const char *text, std::size_t size)
+    {
+        rang_implementation::recordRing &ring = threadRing();
+        const std::size_t header = sizeof(
+          rang_implementation::recordRing::recordHeader);
+        const std::size_t most = capacity_ / 2 - header - style.count() - 8;
+        bool complete          = true;
+        do {
+            const std::size_t piece = size < most ? size : most;
+            complete &= push(ring, style, text, piece);
+            text += piece;
+            size -= piece;
+        } while (size != 0);
+        return complete;
+    }
+
+    bool write(const styleSet &style, const std::string &text)
+    {
+        return write(style, text.data(), text.size());
+    }
+
+    bool write(const styleSet &style, const char *text)
+    {
+        return write(style, text, std::strlen(text));
+    }
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    bool write(const styleSet &style, const std::string_view text)
+    {
+        return write(style, text.data(), text.size());
+    }
+#endif
+
+    // Waits until everything queued so far has been written and flushed
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const long request = ++flushRequests_;
+        wake_.notify_one();
+        done_.wait(lock, [this, request] { return flushed_ >= request; });
+    }
+
+    // Records discarded by the Drop and Overwrite policies so far
+    std::uint64_t dropped() const noexcept { return dropped_.load(); }
+
+    /* Rings held, one per thread that has written and not yet exited
+     * with its records written
+     */
+    std::size_t rings()
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        return rings_.size();
+    }
+
+private:
+    using recordRing = rang_implementation::recordRing;
+
+    static std::size_t roundCapacity(const std::size_t capacity) noexcept
+    {
+        std::size_t size = 1024;
+        while (size < capacity) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    recordRing &threadRing()
+    {
+        std::vector<rang_implementation::ringCache> &cache
+          = rang_implementation::threadRings();
+        for (const rang_implementation::ringCache &entry : cache) {
+            if (entry.sink == id_) {
+                return *entry.ring;
+            }
+        }
+        // Forgets the rings of sinks that are gone
+        cache.erase(std::remove_if(cache.begin(), cache.end(),
+                                   [](const rang_implementation::ringCache &e) {
+                                       return e.ring->closed();
+                                   }),
+                    cache.end());
+        std::shared_ptr<recordRing> ring
+          = std::make_shared<recordRing>(capacity_);
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            rings_.push_back(ring);
+            ringVersion_.fetch_add(1, std::memory_order_release);
+        }
+        cache.push_back({ id_, ring });
+        return *ring;
+    }
+
+    bool push(recordRing &ring, const styleSet &style, const char *text,
+              const std::size_t size)
+    {
+        const std::size_t count = style.count();
+        const std::size_t span  = recordRing::span(count, size);
+        std::uint64_t discarded = 0;
+        long offset             = -1;
+        while ((offset = ring.reserve(span, policy_ == backpressure::Overwrite,
+                                      discarded))
+               < 0) {
+            if (policy_ == backpressure::Drop) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // The writer is draining unless it sleeps, which it only does
+            // with every ring empty; waking it is just a safety net
+            if (sleeping_.load()) {
+                wakeWriter();
+            }
+            std::this_thread::yield();
+        }
+        if (discarded != 0) {
+            dropped_.fetch_add(discarded, std::memory_order_relaxed);
+        }
+
+        recordRing::recordHeader header
+          = { static_cast<std::uint32_t>(size),
+              static_cast<std::uint8_t>(count), { 0, 0, 0 } };
+        char *record = ring.at(offset);
+        std::memcpy(record, &header, sizeof header);
+        std::memcpy(record + sizeof header, style.codes(), count);
+        std::memcpy(record + sizeof header + count, text, size);
+        ring.publish(span);
+        // Pairs with the fence in run: either the writer sees the record
+        // before sleeping or this thread sees it asleep and wakes it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            wakeWriter();
+        }
+        return true;
+    }
+
+    void wakeWriter()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_.notify_one();
+    }
+
+    // Appends a record to the batch, the colors decided for the batch
+    void render(const recordRing::recordHeader &header,
+                const unsigned char *codes, const char *text,
+                const bool colors, const colorLevel level)
+    {
+        if (colors && header.count != 0) {
+            unsigned char mapped[styleSet::maxCodes];
+            char seq[4 + 4 * styleSet::maxCodes];
+            const std::size_t count = rang_implementation::downsample(
+              codes, header.count, level, mapped);
+            const char *end
+              = rang_implementation::writeSequence(seq, mapped, count);
+            batch_.append(seq, static_cast<std::size_t>(end - seq));
+        }
+        if (!colors || header.count == 0) {
+            batch_.append(text, header.size);
+        } else {
+            // The reset goes before a final newline, like in a colored line
+            const bool newline
+              = header.size != 0 && text[header.size - 1] == '\n';
+            batch_.append(text, header.size - (newline ? 1 : 0));
+            batch_.append(newline ? "\033[0m\n" : "\033[0m", newline ? 5 : 4);
+        }
+        if (batch_.size() >= batchSize) {
+            writeBatch();
+        }
+    }
+
+    void writeBatch()
+    {
+        if (!batch_.empty()) {
+            os_.write(batch_.data(),
+                      static_cast<std::streamsize>(batch_.size()));
+            batch_.clear();
+        }
+    }
+
+    // Drains every ring once, returns whether anything was written
+    bool drain()
+    {
+        const std::size_t version
+          = ringVersion_.load(std::memory_order_acquire);
+        if (snapshotVersion_ != version) {
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            ringSnapshot_.clear();
+            for (const std::shared_ptr<recordRing> &ring : rings_) {
+                ringSnapshot_.push_back(ring.get());
+            }
+            snapshotVersion_ = version;
+        }
+        const bool colors = rang_implementation::shouldColorize(os_)
+          && rang_implementation::writesAnsi(os_);
+        const colorLevel level = rang_implementation::colorLevelSetting();
+        bool any = false;
+        for (recordRing *ring : ringSnapshot_) {
+            while (ring->consume(
+              [&](const recordRing::recordHeader &header,
+                  const unsigned char *codes, const char *text) {
+                  render(header, codes, text, colors, level);
+              })) {
+                any = true;
+            }
+        }
+        if (any) {
+            writeBatch();
+            os_.flush();
+        }
+        reclaim();
+        return any;
+    }
+
+    // Frees the rings of exited threads once everything in them is written
+    void reclaim()
+    {
+        const auto kept = std::partition(
+          ringSnapshot_.begin(), ringSnapshot_.end(),
+          [](const recordRing *ring) {
+              return !ring->retired() || !ring->empty();
+          });
+        if (kept == ringSnapshot_.end()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                    [&](const std::shared_ptr<recordRing> &r) {
+                                        return std::find(kept,
+                                                         ringSnapshot_.end(),
+                                                         r.get())
+                                          != ringSnapshot_.end();
+                                    }),
+                     rings_.end());
+        ringSnapshot_.erase(kept, ringSnapshot_.end());
+    }
+
+    bool idle()
+    {
+        for (recordRing *ring : ringSnapshot_) {
+            if (!ring->empty()) {
+                return false;
+            }
+        }
+        return snapshotVersion_
+          == ringVersion_.load(std::memory_order_acquire);
+    }
+
+    void run()
+    {
+        batch_.reserve(batchSize + 256);
+        for (;;) {
+            const long request = flushRequests_.load();
+            if (drain()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (flushed_ < request) {
+                flushed_ = request;
+                done_.notify_all();
+            }
+            if (stop_.load() && idle()) {
+                return;
+            }
+            /* Producers only notify a sleeping writer. sleeping_ is set
+             * before the rings are looked at again, so a record published
+             * meanwhile is either seen here or followed by a notify, which
+             * waits for mutex_ and so can't come before the wait.
+             */
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wake_.wait(lock, [this, request] {
+                return !idle() || flushRequests_.load() != request
+                  || stop_.load();
+            });
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    static constexpr std::size_t batchSize = 64 * 1024;
+
+    std::ostream &os_;
+    const std::uint64_t id_;
+    const std::size_t capacity_;
+    const backpressure policy_;
+    std::atomic<std::uint64_t> dropped_;
+
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<recordRing>> rings_;
+    std::atomic<std::size_t> ringVersion_;    // bumped for every new ring
+    std::size_t snapshotVersion_;             // writer thread only
+    std::vector<recordRing *> ringSnapshot_;  // writer thread only
+    std::string batch_;                       // writer thread only
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> stop_;
+    std::atomic<long> flushRequests_;
+    long flushed_;  // guarded by mutex_
+    std::thread writer_;
+};
+
+}  // namespace rang
+
+#endif /* ifndef RANG_ASYNC_DOT_HPP */
@@ -0,0 +1,537 @@
+#ifndef RANG_CORE_INL_DOT_HPP
+#define RANG_CORE_INL_DOT_HPP
+
+// Platform and detection code of rang/core.hpp, inline in header-only mode
+// and built once from src/rang.cpp with RANG_COMPILED
+
+#include "core.hpp"
+
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+#include <unistd.h>
+
+#elif defined(RANG_OS_WIN)
+
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT < 0x0600)
+#error                                                                         \
+  "Please include rang.hpp before any windows system headers or set _WIN32_WINNT at least to _WIN32_WINNT_VISTA"
+#elif !defined(_WIN32_WINNT)
+#define _WIN32_WINNT _WIN32_WINNT_VISTA
+#endif
+
+// Without the min and max macros, which break std::numeric_limits<T>::max()
+#ifndef NOMINMAX
+#define NOMINMAX
+#define RANG_UNDEF_NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define RANG_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifdef RANG_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef RANG_UNDEF_NOMINMAX
+#endif
+#ifdef RANG_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef RANG_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#include <io.h>
+#include <memory>
+#include <string>
+
+// Only defined in windows 10 onwards, redefining in lower windows since it
+// doesn't gets used in lower versions
+// https://docs.microsoft.com/en-us/windows/console/getconsolemode
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+#endif
+
+#include <cstdlib>
+
+namespace rang {
+namespace rang_implementation {
+
+    // Value of an environment variable, buf backs it on Windows
+    inline const char *envValue(const char *name, char (&buf)[32]) noexcept
+    {
+#if defined(RANG_OS_WIN)
+        const DWORD n = GetEnvironmentVariableA(name, buf, sizeof buf);
+        return n > 0 && n < sizeof buf ? buf : nullptr;
+#else
+        (void) buf;
+        return std::getenv(name);
+#endif
+    }
+
+    // FORCE_COLOR as understood by most tools: 0 or false, 1, 2 and 3
+    inline rang::colorLevel forcedColorLevel(const char *value) noexcept
+    {
+        if (std::strcmp(value, "0") == 0 || std::strcmp(value, "false") == 0) {
+            return rang::colorLevel::None;
+        }
+        if (std::strcmp(value, "2") == 0) {
+            return rang::colorLevel::Ansi256;
+        }
+        if (std::strcmp(value, "3") == 0) {
+            return rang::colorLevel::TrueColor;
+        }
+        return rang::colorLevel::Ansi16;
+    }
+
+    RANG_INLINE rang::colorLevel detectColorLevel() noexcept
+    {
+        char buf[32];
+        const char *noColor = envValue("NO_COLOR", buf);
+        if (noColor != nullptr && *noColor != '\0') {
+            return rang::colorLevel::None;
+        }
+        const char *forceColor = envValue("FORCE_COLOR", buf);
+        if (forceColor != nullptr) {
+            return forcedColorLevel(forceColor);
+        }
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+        const char *Terms[]
+          = { "ansi",    "color",  "console", "cygwin", "gnome",
+              "konsole", "kterm",  "linux",   "msys",   "putty",
+              "rxvt",    "screen", "vt100",   "xterm" };
+
+        const char *env_p = std::getenv("TERM");
+        if (env_p == nullptr || std::strcmp(env_p, "dumb") == 0) {
+            return rang::colorLevel::None;
+        }
+        const char *colorTerm = std::getenv("COLORTERM");
+        if ((colorTerm != nullptr
+             && (std::strcmp(colorTerm, "truecolor") == 0
+                 || std::strcmp(colorTerm, "24bit") == 0))
+            || std::strstr(env_p, "direct") != nullptr) {
+            return rang::colorLevel::TrueColor;
+        }
+        if (std::strstr(env_p, "256") != nullptr) {
+            return rang::colorLevel::Ansi256;
+        }
+        for (const char *term : Terms) {
+            if (std::strstr(env_p, term) != nullptr) {
+                return rang::colorLevel::Ansi16;
+            }
+        }
+        return rang::colorLevel::None;
+#elif defined(RANG_OS_WIN)
+        // Native console methods are mapped to 16 colors, Windows 10
+        // terminals understand 24-bit sequences
+        return rang::colorLevel::TrueColor;
+#endif
+    }
+
+#ifdef RANG_OS_WIN
+
+    inline bool isMsysPty(int fd) noexcept
+    {
+        // Dynamic load for binary compability with old Windows
+        const auto ptrGetFileInformationByHandleEx
+          = reinterpret_cast<decltype(&GetFileInformationByHandleEx)>(
+            GetProcAddress(GetModuleHandle(TEXT("kernel32.dll")),
+                           "GetFileInformationByHandleEx"));
+        if (!ptrGetFileInformationByHandleEx) {
+            return false;
+        }
+
+        HANDLE h = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        if (h == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        // Check that it's a pipe:
+        if (GetFileType(h) != FILE_TYPE_PIPE) {
+            return false;
+        }
+
+        // POD type is binary compatible with FILE_NAME_INFO from WinBase.h
+        // It have the same alignment and used to avoid UB in caller code
+        struct MY_FILE_NAME_INFO {
+            DWORD FileNameLength;
+            WCHAR FileName[MAX_PATH];
+        };
+
+        auto pNameInfo = std::unique_ptr<MY_FILE_NAME_INFO>(
+          new (std::nothrow) MY_FILE_NAME_INFO());
+        if (!pNameInfo) {
+            return false;
+        }
+
+        // Check pipe name is template of
+        // {"cygwin-","msys-"}XXXXXXXXXXXXXXX-ptyX-XX
+        if (!ptrGetFileInformationByHandleEx(h, FileNameInfo, pNameInfo.get(),
+                                             sizeof(MY_FILE_NAME_INFO))) {
+            return false;
+        }
+        std::wstring name(pNameInfo->FileName, pNameInfo->FileNameLength / sizeof(WCHAR));
+        if ((name.find(L"msys-") == std::wstring::npos
+             && name.find(L"cygwin-") == std::wstring::npos)
+            || name.find(L"-pty") == std::wstring::npos) {
+            return false;
+        }
+
+        return true;
+    }
+
+#endif
+
+    RANG_INLINE bool isTerminalFd(const int fd) noexcept
+    {
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+        return isatty(fd) != 0;
+#elif defined(RANG_OS_WIN)
+        return _isatty(fd) || isMsysPty(fd);
+#endif
+    }
+
+#ifdef RANG_OS_WIN
+
+    struct SGR {  // Select Graphic Rendition parameters for Windows console
+        BYTE fgColor;  // foreground color (0-15) lower 3 rgb bits + intense bit
+        BYTE bgColor;  // background color (0-15) lower 3 rgb bits + intense bit
+        BYTE bold;  // emulated as FOREGROUND_INTENSITY bit
+        BYTE underline;  // emulated as BACKGROUND_INTENSITY bit
+        BOOLEAN inverse;  // swap foreground/bold & background/underline
+        BOOLEAN conceal;  // set foreground/bold to background/underline
+    };
+
+    enum class AttrColor : BYTE {  // Color attributes for console screen buffer
+        black   = 0,
+        red     = 4,
+        green   = 2,
+        yellow  = 6,
+        blue    = 1,
+        magenta = 5,
+        cyan    = 3,
+        gray    = 7
+    };
+
+    inline const SGR &defaultState() noexcept
+    {
+        static const SGR defaultSgr = []() -> SGR {
+            CONSOLE_SCREEN_BUFFER_INFO info;
+            WORD attrib = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+            if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE),
+                                           &info)
+                || GetConsoleScreenBufferInfo(GetStdHandle(STD_ERROR_HANDLE),
+                                              &info)) {
+                attrib = info.wAttributes;
+            }
+            SGR sgr     = { 0, 0, 0, 0, FALSE, FALSE };
+            sgr.fgColor = attrib & 0x0F;
+            sgr.bgColor = (attrib & 0xF0) >> 4;
+            return sgr;
+        }();
+        return defaultSgr;
+    }
+
+    inline BYTE ansi2attr(BYTE rgb) noexcept
+    {
+        static const AttrColor rev[8]
+          = { AttrColor::black,  AttrColor::red,  AttrColor::green,
+              AttrColor::yellow, AttrColor::blue, AttrColor::magenta,
+              AttrColor::cyan,   AttrColor::gray };
+        return static_cast<BYTE>(rev[rgb]);
+    }
+
+    inline void setWinSGR(rang::bg col, SGR &state) noexcept
+    {
+        if (col != rang::bg::reset) {
+            state.bgColor = ansi2attr(static_cast<BYTE>(col) - 40);
+        } else {
+            state.bgColor = defaultState().bgColor;
+        }
+    }
+
+    inline void setWinSGR(rang::fg col, SGR &state) noexcept
+    {
+        if (col != rang::fg::reset) {
+            state.fgColor = ansi2attr(static_cast<BYTE>(col) - 30);
+        } else {
+            state.fgColor = defaultState().fgColor;
+        }
+    }
+
+    inline void setWinSGR(rang::bgB col, SGR &state) noexcept
+    {
+        state.bgColor = (BACKGROUND_INTENSITY >> 4)
+          | ansi2attr(static_cast<BYTE>(col) - 100);
+    }
+
+    inline void setWinSGR(rang::fgB col, SGR &state) noexcept
+    {
+        state.fgColor
+          = FOREGROUND_INTENSITY | ansi2attr(static_cast<BYTE>(col) - 90);
+    }
+
+    inline void setWinSGR(rang::style style, SGR &state) noexcept;
+
+    // Console attributes know 16 colors, extended ones use the closest
+    inline void setWinSGR16(const bool foreground, const std::uint8_t index,
+                            SGR &state) noexcept
+    {
+        if (foreground) {
+            if (index < 8) {
+                setWinSGR(static_cast<rang::fg>(30 + index), state);
+            } else {
+                setWinSGR(static_cast<rang::fgB>(90 + index - 8), state);
+            }
+        } else if (index < 8) {
+            setWinSGR(static_cast<rang::bg>(40 + index), state);
+        } else {
+            setWinSGR(static_cast<rang::bgB>(100 + index - 8), state);
+        }
+    }
+
+    inline void setWinSGR(const unsigned char *codes, const std::size_t count,
+                          SGR &state) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            const int code           = codes[i];
+            const std::size_t length = groupLength(codes + i, count - i);
+            if (length == 3) {
+                const std::uint8_t index = codes[i + 2];
+                setWinSGR16(code == 38,
+                            index < 16 ? index
+                                       : nearestAnsi16(paletteColor(index)),
+                            state);
+                i += length - 1;
+            } else if (length == 5) {
+                const rgbColor color
+                  = { codes[i + 2], codes[i + 3], codes[i + 4] };
+                setWinSGR16(code == 38, nearestAnsi16(color), state);
+                i += length - 1;
+            } else if (code < 30) {
+                setWinSGR(static_cast<rang::style>(code), state);
+            } else if (code < 40) {
+                setWinSGR(static_cast<rang::fg>(code), state);
+            } else if (code < 90) {
+                setWinSGR(static_cast<rang::bg>(code), state);
+            } else if (code < 100) {
+                setWinSGR(static_cast<rang::fgB>(code), state);
+            } else {
+                setWinSGR(static_cast<rang::bgB>(code), state);
+            }
+        }
+    }
+
+    inline void setWinSGR(const rang::styleSet &set, SGR &state) noexcept
+    {
+        setWinSGR(set.codes(), set.count(), state);
+    }
+
+    template <typename T>
+    inline typename std::enable_if<isExtendedColor<T>::value>::type
+    setWinSGR(const T &color, SGR &state) noexcept
+    {
+        const sgrCodes codes = codesOf(color);
+        setWinSGR(codes.data, codes.count, state);
+    }
+
+    template <int... Codes>
+    inline void setWinSGR(const rang::ansiSeq<Codes...> &, SGR &state) noexcept
+    {
+        setWinSGR(rang::ansiSeq<Codes...>::codes, sizeof...(Codes), state);
+    }
+
+    inline void setWinSGR(rang::style style, SGR &state) noexcept
+    {
+        switch (style) {
+            case rang::style::reset: state = defaultState(); break;
+            case rang::style::bold: state.bold = FOREGROUND_INTENSITY; break;
+            case rang::style::underline:
+            case rang::style::blink:
+                state.underline = BACKGROUND_INTENSITY;
+                break;
+            case rang::style::reversed: state.inverse = TRUE; break;
+            case rang::style::conceal: state.conceal = TRUE; break;
+            default: break;
+        }
+    }
+
+    inline SGR &current_state() noexcept
+    {
+        static SGR state = defaultState();
+        return state;
+    }
+
+    inline WORD SGR2Attr(const SGR &state) noexcept
+    {
+        WORD attrib = 0;
+        if (state.conceal) {
+            if (state.inverse) {
+                attrib = (state.fgColor << 4) | state.fgColor;
+                if (state.bold)
+                    attrib |= FOREGROUND_INTENSITY | BACKGROUND_INTENSITY;
+            } else {
+                attrib = (state.bgColor << 4) | state.bgColor;
+                if (state.underline)
+                    attrib |= FOREGROUND_INTENSITY | BACKGROUND_INTENSITY;
+            }
+        } else if (state.inverse) {
+            attrib = (state.fgColor << 4) | state.bgColor;
+            if (state.bold) attrib |= BACKGROUND_INTENSITY;
+            if (state.underline) attrib |= FOREGROUND_INTENSITY;
+        } else {
+            attrib = state.fgColor | (state.bgColor << 4) | state.bold
+              | state.underline;
+        }
+        return attrib;
+    }
+
+    // The console attributes for codes, to the console behind handle
+    inline void setConsoleCodes(const HANDLE handle, const unsigned char *codes,
+                                const std::size_t count) noexcept
+    {
+        setWinSGR(codes, count, current_state());
+        SetConsoleTextAttribute(handle, SGR2Attr(current_state()));
+    }
+
+    // Turns on escape processing of a Windows 10 console
+    inline bool enableVtMode(const HANDLE handle) noexcept
+    {
+        DWORD dwMode = 0;
+        if (handle == INVALID_HANDLE_VALUE
+            || !GetConsoleMode(handle, &dwMode)) {
+            return false;
+        }
+        dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+        return SetConsoleMode(handle, dwMode) != 0;
+    }
+
+    // Whether fd takes escapes in winTerm::Auto, decided once for stdout
+    // and stderr
+    inline bool autoAnsi(const int fd) noexcept
+    {
+        if (fd == _fileno(stdout)) {
+            static const bool out_ansi = isMsysPty(fd)
+              || enableVtMode(GetStdHandle(STD_OUTPUT_HANDLE));
+            return out_ansi;
+        } else if (fd == _fileno(stderr)) {
+            static const bool err_ansi = isMsysPty(fd)
+              || enableVtMode(GetStdHandle(STD_ERROR_HANDLE));
+            return err_ansi;
+        }
+        return isMsysPty(fd);
+    }
+
+    RANG_INLINE bool writesAnsi(const int fd) noexcept
+    {
+        const winTerm mode = winTermMode().load();
+        if (mode != winTerm::Auto) {
+            return mode == winTerm::Ansi;
+        }
+        return autoAnsi(fd);
+    }
+
+#endif
+
+#ifdef RANG_OS_WIN
+    RANG_INLINE bool setConsoleStyle(const int fd, const rang::styleSet &style,
+                                std::FILE *file) noexcept
+    {
+        const control mode = controlMode().load();
+        if (mode == control::Off || writesAnsi(fd)
+            || (mode == control::Auto && !supportsColor())) {
+            return false;
+        }
+        const HANDLE h = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        DWORD consoleMode = 0;
+        if (h == INVALID_HANDLE_VALUE || !GetConsoleMode(h, &consoleMode)) {
+            return false;
+        }
+        if (file != nullptr) {
+            std::fflush(file);
+        }
+        setConsoleCodes(h, style.codes(), style.count());
+        return true;
+    }
+#else
+    RANG_INLINE bool setConsoleStyle(int, const rang::styleSet &,
+                                std::FILE *) noexcept
+    {
+        return false;
+    }
+#endif
+
+    RANG_INLINE bool writeFd(const int fd, const char *data,
+                        std::size_t size) noexcept
+    {
+        while (size > 0) {
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+            const ssize_t n = ::write(fd, data, size);
+#elif defined(RANG_OS_WIN)
+            const unsigned most = 1u << 30;
+            const int n         = _write(
+              fd, data, size < most ? static_cast<unsigned>(size) : most);
+#endif
+            if (n < 0 && errno == EINTR) {
+                continue;  // a signal came before anything was written
+            }
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+}  // namespace rang_implementation
+
+RANG_INLINE environment probeEnvironment() noexcept
+{
+    environment env;
+    env.level = rang_implementation::detectColorLevel();
+    for (int fd = 0; fd < 3; ++fd) {
+        env.terminal[fd] = rang_implementation::isTerminalFd(fd);
+    }
+    return env;
+}
+
+RANG_INLINE environment init(const initOptions &options) noexcept
+{
+    namespace impl = rang_implementation;
+    char buf[32];
+    const char *inherited = options.inherit != nullptr
+      ? impl::envValue(options.inherit, buf)
+      : nullptr;
+    environment env;
+    if (!parseEnvironment(inherited, env)) {
+        env = probeEnvironment();
+    }
+    if (inherited != nullptr && options.consume) {
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+        unsetenv(options.inherit);
+#elif defined(RANG_OS_WIN)
+        SetEnvironmentVariableA(options.inherit, nullptr);
+#endif
+    }
+
+    impl::colorLevelState() = static_cast<int>(env.level) + 1;
+    for (int fd = 0; fd < 3; ++fd) {
+        impl::stdTerminals()[fd] = env.terminal[fd] ? 2 : 1;
+    }
+    impl::controlEpoch().fetch_add(1, std::memory_order_release);
+    return env;
+}
+
+RANG_INLINE bool exportEnvironment(const environment &env,
+                                   const char *name) noexcept
+{
+    char value[5];
+    formatEnvironment(env, value);
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+    return setenv(name, value, 1) == 0;
+#elif defined(RANG_OS_WIN)
+    return SetEnvironmentVariableA(name, value) != 0;
+#endif
+}
+
+}  // namespace rang
+
+#endif /* ifndef RANG_CORE_INL_DOT_HPP */
@@ -0,0 +1,1017 @@
+#ifndef RANG_CORE_DOT_HPP
+#define RANG_CORE_DOT_HPP
+
+/* Escape sequences, styleSet, the control modes and colored output to file
+ * descriptors, FILE* and char buffers, without iostreams. In header-only
+ * mode the platform code comes with it from rang/core-inl.hpp.
+ */
+
+#include "fwd.hpp"
+
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+#include <sys/uio.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace rang {
+
+namespace rang_implementation {
+
+    // Writes an SGR parameter (0-255) in decimal, returns the new end
+    inline char *writeCode(char *out, unsigned value) noexcept
+    {
+        if (value >= 100) {
+            *out++ = static_cast<char>('0' + value / 100);
+        }
+        if (value >= 10) {
+            *out++ = static_cast<char>('0' + value / 10 % 10);
+        }
+        *out++ = static_cast<char>('0' + value % 10);
+        return out;
+    }
+
+    // Writes "\033[<codes joined by ;>m", returns the new end
+    inline char *writeSequence(char *out, const unsigned char *codes,
+                               const std::size_t count) noexcept
+    {
+        *out++ = '\033';
+        *out++ = '[';
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i != 0) {
+                *out++ = ';';
+            }
+            out = writeCode(out, codes[i]);
+        }
+        *out++ = 'm';
+        return out;
+    }
+
+    // Number of codes forming one attribute: 38/48 take 2 or 4 arguments
+    inline std::size_t groupLength(const unsigned char *codes,
+                                   const std::size_t count) noexcept
+    {
+        if ((codes[0] == 38 || codes[0] == 48) && count >= 2) {
+            const std::size_t length
+              = codes[1] == 5 ? 3 : codes[1] == 2 ? 5 : 1;
+            return length <= count ? length : count;
+        }
+        return 1;
+    }
+
+    // SGR parameters of the extended colors
+    struct sgrCodes {
+        unsigned char data[5];
+        std::size_t count;
+    };
+
+    inline sgrCodes codesOf(const rang::fgRgb &color) noexcept
+    {
+        return { { 38, 2, color.r, color.g, color.b }, 5 };
+    }
+
+    inline sgrCodes codesOf(const rang::bgRgb &color) noexcept
+    {
+        return { { 48, 2, color.r, color.g, color.b }, 5 };
+    }
+
+    inline sgrCodes codesOf(const rang::fg256 &color) noexcept
+    {
+        return { { 38, 5, color.index, 0, 0 }, 3 };
+    }
+
+    inline sgrCodes codesOf(const rang::bg256 &color) noexcept
+    {
+        return { { 48, 5, color.index, 0, 0 }, 3 };
+    }
+
+    // Longest extended color sequence, "\033[38;2;255;255;255m"
+    struct escapeBuf {
+        char data[20];
+        std::size_t size;
+    };
+
+    inline escapeBuf encode(const sgrCodes &codes) noexcept
+    {
+        escapeBuf buf;
+        buf.size = static_cast<std::size_t>(
+          writeSequence(buf.data, codes.data, codes.count) - buf.data);
+        return buf;
+    }
+
+    struct rgbColor {
+        std::uint8_t r, g, b;
+    };
+
+    // xterm's default for one of the 16 basic colors, index 0-15
+    inline rgbColor systemColor(const std::uint8_t index) noexcept
+    {
+        static const rgbColor system[16]
+          = { { 0, 0, 0 },       { 205, 0, 0 },     { 0, 205, 0 },
+              { 205, 205, 0 },   { 0, 0, 238 },     { 205, 0, 205 },
+              { 0, 205, 205 },   { 229, 229, 229 }, { 127, 127, 127 },
+              { 255, 0, 0 },     { 0, 255, 0 },     { 255, 255, 0 },
+              { 92, 92, 255 },   { 255, 0, 255 },   { 0, 255, 255 },
+              { 255, 255, 255 } };
+        return system[index & 15];
+    }
+
+    // A cube or gray ramp entry of the palette, index 16-255
+    inline rgbColor cubeOrGray(const std::uint8_t index) noexcept
+    {
+        static const std::uint8_t cube[6] = { 0, 95, 135, 175, 215, 255 };
+        if (index < 232) {
+            const int i = index - 16;
+            return { cube[i / 36], cube[i / 6 % 6], cube[i % 6] };
+        }
+        const std::uint8_t gray
+          = static_cast<std::uint8_t>(8 + 10 * (index - 232));
+        return { gray, gray, gray };
+    }
+
+    // xterm's default for an entry of the 256 color palette
+    inline rgbColor paletteColor(const std::uint8_t index) noexcept
+    {
+        return index < 16 ? systemColor(index) : cubeOrGray(index);
+    }
+
+    // Closest of the 16 basic colors, 0-7 normal and 8-15 bright
+    inline std::uint8_t nearestAnsi16(const rgbColor color) noexcept
+    {
+        std::uint8_t best = 0;
+        long bestDistance = -1;
+        for (std::uint8_t i = 0; i < 16; ++i) {
+            const rgbColor entry = systemColor(i);
+            const long dr        = color.r - entry.r;
+            const long dg        = color.g - entry.g;
+            const long db        = color.b - entry.b;
+            const long distance  = dr * dr + dg * dg + db * db;
+            if (bestDistance < 0 || distance < bestDistance) {
+                best         = i;
+                bestDistance = distance;
+            }
+        }
+        return best;
+    }
+
+    template <typename T>
+    using isSgrEnum = std::integral_constant<
+      bool,
+      std::is_same<T, rang::style>::value || std::is_same<T, rang::fg>::value
+        || std::is_same<T, rang::bg>::value || std::is_same<T, rang::fgB>::value
+        || std::is_same<T, rang::bgB>::value>;
+
+    template <typename T>
+    using isExtendedColor = std::integral_constant<
+      bool,
+      std::is_same<T, rang::fgRgb>::value || std::is_same<T, rang::bgRgb>::value
+        || std::is_same<T, rang::fg256>::value
+        || std::is_same<T, rang::bg256>::value>;
+
+    // colorLevel of the terminal, from the environment variables
+    RANG_INLINE rang::colorLevel detectColorLevel() noexcept;
+
+    /* The colorLevel in use plus one, zero until it is detected. Constant
+     * initialized, so reading it needs no static guard. Threads detecting
+     * it at the same time find the same level, only the first one stores.
+     */
+    inline std::atomic<int> &colorLevelState() noexcept
+    {
+        static std::atomic<int> state;  // zero initialized
+        return state;
+    }
+
+    inline rang::colorLevel colorLevelSetting() noexcept
+    {
+        int state = colorLevelState().load(std::memory_order_relaxed);
+        if (state == 0) {
+            const int detected = static_cast<int>(detectColorLevel()) + 1;
+            state = colorLevelState().compare_exchange_strong(state, detected)
+              ? detected
+              : state;
+        }
+        return static_cast<rang::colorLevel>(state - 1);
+    }
+
+    // Lookup tables mapping extended colors to what the terminal supports
+    struct paletteTables {
+        std::uint8_t cubeLevel[256];  // channel value to 6x6x6 cube level
+        std::uint8_t grayIndex[256];  // channel value to nearest gray entry
+        std::uint8_t ansi16[256];  // palette index to nearest 16 colors index
+    };
+
+    inline long distance(const rgbColor lhs, const rgbColor rhs) noexcept
+    {
+        const long dr = lhs.r - rhs.r;
+        const long dg = lhs.g - rhs.g;
+        const long db = lhs.b - rhs.b;
+        return dr * dr + dg * dg + db * db;
+    }
+
+    inline const paletteTables &downsampleTables() noexcept
+    {
+        static const paletteTables tables = [] {
+            paletteTables t;
+            for (int v = 0; v < 256; ++v) {
+                // Midpoints of the cube steps 0, 95, 135, 175, 215, 255
+                t.cubeLevel[v] = static_cast<std::uint8_t>(
+                  v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40);
+
+                // Grays of the ramp 232-255 and of the cube diagonal
+                const rgbColor gray = { static_cast<std::uint8_t>(v),
+                                        static_cast<std::uint8_t>(v),
+                                        static_cast<std::uint8_t>(v) };
+                std::uint8_t best = 16;
+                for (int i = 1; i < 30; ++i) {
+                    const std::uint8_t index = static_cast<std::uint8_t>(
+                      i < 6 ? 16 + 43 * i : 232 + i - 6);
+                    if (distance(gray, cubeOrGray(index))
+                        < distance(gray, cubeOrGray(best))) {
+                        best = index;
+                    }
+                }
+                t.grayIndex[v] = best;
+
+                t.ansi16[v] = v < 16 ? static_cast<std::uint8_t>(v)
+                                     : nearestAnsi16(cubeOrGray(
+                                       static_cast<std::uint8_t>(v)));
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    // Nearest palette entry: the cube cell or the gray, whichever is closer
+    inline std::uint8_t rgbTo256(const rgbColor color) noexcept
+    {
+        const paletteTables &t = downsampleTables();
+        const std::uint8_t cube
+          = static_cast<std::uint8_t>(16 + 36 * t.cubeLevel[color.r]
+                                      + 6 * t.cubeLevel[color.g]
+                                      + t.cubeLevel[color.b]);
+        const std::uint8_t gray
+          = t.grayIndex[(color.r + color.g + color.b) / 3];
+        return distance(color, cubeOrGray(gray))
+            < distance(color, cubeOrGray(cube))
+          ? gray
+          : cube;
+    }
+
+    /* Copies codes to out, rewriting extended colors the level can't show:
+     * 24-bit to the 256 palette for Ansi256, both to fg/fgB/bg/bgB for
+     * Ansi16. Returns the number of codes written, never more than count.
+     */
+    inline std::size_t downsample(const unsigned char *codes,
+                                  const std::size_t count,
+                                  const rang::colorLevel level,
+                                  unsigned char *out) noexcept
+    {
+        const bool keep = level == rang::colorLevel::TrueColor
+          || level == rang::colorLevel::None;
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < count;) {
+            const std::size_t length = groupLength(codes + i, count - i);
+            if (length == 1 || keep
+                || (length == 3 && level == rang::colorLevel::Ansi256)) {
+                for (std::size_t j = 0; j < length; ++j) {
+                    out[n++] = codes[i + j];
+                }
+            } else {
+                const bool foreground = codes[i] == 38;
+                const std::uint8_t index
+                  = length == 5 ? rgbTo256({ codes[i + 2], codes[i + 3],
+                                              codes[i + 4] })
+                                : codes[i + 2];
+                if (level == rang::colorLevel::Ansi256) {
+                    out[n++] = codes[i];
+                    out[n++] = 5;
+                    out[n++] = index;
+                } else {
+                    const std::uint8_t basic
+                      = downsampleTables().ansi16[index];
+                    const int base = foreground ? (basic < 8 ? 30 : 82)
+                                                : (basic < 8 ? 40 : 92);
+                    out[n++] = static_cast<unsigned char>(base + basic);
+                }
+            }
+            i += length;
+        }
+        return n;
+    }
+
+}  // namespace rang_implementation
+
+/* Immutable combination of styles and colors, built with operator|
+ *
+ *   const rang::styleSet alert = rang::style::bold | rang::fg::red;
+ *   std::cout << alert << "ERROR" << rang::style::reset;
+ *
+ * The escape sequence ("\033[1;31m") is encoded once on construction and
+ * written to the stream with a single call, so keep sets around instead of
+ * rebuilding them for every line. Codes beyond maxCodes are dropped.
+ */
+class styleSet {
+public:
+    static constexpr std::size_t maxCodes = 16;
+
+    styleSet() noexcept : count_(0), size_(0), extended_(false)
+    {
+        seq_[0] = '\0';
+    }
+    styleSet(const style value) noexcept : styleSet() { push(value); }
+    styleSet(const fg value) noexcept : styleSet() { push(value); }
+    styleSet(const bg value) noexcept : styleSet() { push(value); }
+    styleSet(const fgB value) noexcept : styleSet() { push(value); }
+    styleSet(const bgB value) noexcept : styleSet() { push(value); }
+    styleSet(const fgRgb &value) noexcept : styleSet()
+    {
+        push(rang_implementation::codesOf(value));
+    }
+    styleSet(const bgRgb &value) noexcept : styleSet()
+    {
+        push(rang_implementation::codesOf(value));
+    }
+    styleSet(const fg256 &value) noexcept : styleSet()
+    {
+        push(rang_implementation::codesOf(value));
+    }
+    styleSet(const bg256 &value) noexcept : styleSet()
+    {
+        push(rang_implementation::codesOf(value));
+    }
+
+    const char *data() const noexcept { return seq_; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return count_ == 0; }
+
+    // Raw SGR parameters in insertion order
+    const unsigned char *codes() const noexcept { return codes_; }
+    std::size_t count() const noexcept { return count_; }
+
+    // Whether the set holds 24-bit or 256 palette colors
+    bool extended() const noexcept { return extended_; }
+
+    friend styleSet operator|(styleSet lhs, const styleSet &rhs) noexcept;
+
+private:
+    template <typename T>
+    void push(const T value) noexcept
+    {
+        const unsigned char code = static_cast<unsigned char>(value);
+        append(&code, 1);
+        encode();
+    }
+
+    void push(const rang_implementation::sgrCodes &codes) noexcept
+    {
+        append(codes.data, codes.count);
+        extended_ = true;
+        encode();
+    }
+
+    // Whole attributes only, a truncated 38;2;r;g;b would garble the rest
+    void append(const unsigned char *codes, const std::size_t count) noexcept
+    {
+        if (count_ + count <= maxCodes) {
+            for (std::size_t i = 0; i < count; ++i) {
+                codes_[count_++] = codes[i];
+            }
+        }
+    }
+
+    void encode() noexcept
+    {
+        if (count_ == 0) {
+            size_   = 0;
+            seq_[0] = '\0';
+            return;
+        }
+        char *out
+          = rang_implementation::writeSequence(seq_, codes_, count_);
+        *out  = '\0';
+        size_ = static_cast<unsigned char>(out - seq_);
+    }
+
+    unsigned char codes_[maxCodes];
+    unsigned char count_;
+    unsigned char size_;
+    bool extended_;
+    char seq_[4 + 4 * maxCodes];
+};
+
+inline styleSet operator|(styleSet lhs, const styleSet &rhs) noexcept
+{
+    std::size_t i = 0;
+    while (i < rhs.count_) {
+        const std::size_t length = rang_implementation::groupLength(
+          rhs.codes_ + i, rhs.count_ - i);
+        lhs.append(rhs.codes_ + i, length);
+        i += length;
+    }
+    lhs.extended_ = lhs.extended_ || rhs.extended_;
+    lhs.encode();
+    return lhs;
+}
+
+// Two plain enums never consider the styleSet overload, hence this one
+template <typename T, typename U>
+inline typename std::enable_if<rang_implementation::isSgrEnum<T>::value
+                                 && rang_implementation::isSgrEnum<U>::value,
+                               styleSet>::type
+operator|(const T lhs, const U rhs) noexcept
+{
+    return styleSet(lhs) | styleSet(rhs);
+}
+
+// Value of an attribute as SGR parameter, usable in constant expressions
+template <typename T>
+constexpr typename std::enable_if<rang_implementation::isSgrEnum<T>::value,
+                                  int>::type
+sgrCode(const T value) noexcept
+{
+    return static_cast<int>(value);
+}
+
+namespace rang_implementation {
+
+    template <std::size_t... Is>
+    struct indexSeq {
+    };
+
+    template <std::size_t N, std::size_t... Is>
+    struct makeIndexSeq : makeIndexSeq<N - 1, N - 1, Is...> {
+    };
+
+    template <std::size_t... Is>
+    struct makeIndexSeq<0, Is...> {
+        using type = indexSeq<Is...>;
+    };
+
+    constexpr std::size_t codeWidth(const int code) noexcept
+    {
+        return code >= 100 ? 3 : code >= 10 ? 2 : 1;
+    }
+
+    constexpr int pow10(const std::size_t n) noexcept
+    {
+        return n == 0 ? 1 : 10 * pow10(n - 1);
+    }
+
+    constexpr char codeDigit(const int code, const std::size_t i) noexcept
+    {
+        return static_cast<char>(
+          '0' + code / pow10(codeWidth(code) - 1 - i) % 10);
+    }
+
+    // Parameters of a sequence joined with ';', one character at a time
+    template <int... Codes>
+    struct sgrParams;
+
+    template <>
+    struct sgrParams<> {
+        static constexpr std::size_t size = 0;
+        static constexpr char at(std::size_t) noexcept { return '\0'; }
+    };
+
+    template <int Code, int... Rest>
+    struct sgrParams<Code, Rest...> {
+        static_assert(Code >= 0 && Code <= 255, "SGR parameter out of range");
+        using tail = sgrParams<Rest...>;
+
+        static constexpr std::size_t size
+          = codeWidth(Code) + (sizeof...(Rest) == 0 ? 0 : 1 + tail::size);
+
+        static constexpr char at(const std::size_t i) noexcept
+        {
+            return i < codeWidth(Code)
+              ? codeDigit(Code, i)
+              : i == codeWidth(Code) ? ';' : tail::at(i - codeWidth(Code) - 1);
+        }
+    };
+
+    template <typename Params, typename Indexes>
+    struct sgrChars;
+
+    template <typename Params, std::size_t... Is>
+    struct sgrChars<Params, indexSeq<Is...>> {
+        static constexpr std::size_t size = Params::size + 3;
+
+        static constexpr char at(const std::size_t i) noexcept
+        {
+            return i == 0
+              ? '\033'
+              : i == 1 ? '[' : i == size - 1 ? 'm' : Params::at(i - 2);
+        }
+
+        static constexpr char value[size + 1] = { at(Is)..., '\0' };
+    };
+
+    template <typename Params, std::size_t... Is>
+    constexpr char sgrChars<Params, indexSeq<Is...>>::value[];
+
+}  // namespace rang_implementation
+
+/* Escape sequence generated at compile time, e.g.
+ *
+ *   std::cout << rang::ansiSeq<rang::sgrCode(rang::fg::red),
+ *                              rang::sgrCode(rang::style::bold)>{};
+ *
+ * ansiSeq<...>::value is a static constexpr "\033[31;1m" and inserting it
+ * is a single write of that literal. With C++17 the shorter spelling
+ * rang::seq<rang::fg::red, rang::style::bold> is available.
+ */
+template <int... Codes>
+struct ansiSeq
+    : rang_implementation::sgrChars<
+        rang_implementation::sgrParams<Codes...>,
+        typename rang_implementation::makeIndexSeq<
+          rang_implementation::sgrParams<Codes...>::size + 3>::type> {
+    static constexpr std::size_t count = sizeof...(Codes);
+    static constexpr unsigned char codes[count + 1]
+      = { static_cast<unsigned char>(Codes)..., 0 };
+};
+
+template <int... Codes>
+constexpr unsigned char ansiSeq<Codes...>::codes[];
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+template <auto... Values>
+using seq = ansiSeq<sgrCode(Values)...>;
+#endif
+
+namespace rang_implementation {
+
+    inline std::atomic<control> &controlMode() noexcept
+    {
+        static std::atomic<control> value(control::Auto);
+        return value;
+    }
+
+    inline std::atomic<winTerm> &winTermMode() noexcept
+    {
+        static std::atomic<winTerm> termMode(winTerm::Auto);
+        return termMode;
+    }
+
+    // Bumped on every setControlMode, invalidates cached stream decisions
+    inline std::atomic<long> &controlEpoch() noexcept
+    {
+        static std::atomic<long> epoch(1);
+        return epoch;
+    }
+
+    inline bool supportsColor() noexcept
+    {
+        return colorLevelSetting() != rang::colorLevel::None;
+    }
+
+    RANG_INLINE bool isTerminalFd(int fd) noexcept;
+
+    // Whether stdin, stdout and stderr are terminals: 0 until probed, then
+    // 1 for no and 2 for yes, probed once or given to init
+    inline std::atomic<int> *stdTerminals() noexcept
+    {
+        static std::atomic<int> terminals[3];  // zero initialized
+        return terminals;
+    }
+
+    inline bool isStdTerminal(const int fd) noexcept
+    {
+        std::atomic<int> &known = stdTerminals()[fd];
+        int state               = known.load(std::memory_order_relaxed);
+        if (state == 0) {
+            state = isTerminalFd(fd) ? 2 : 1;
+            known.store(state, std::memory_order_relaxed);
+        }
+        return state == 2;
+    }
+
+#ifdef RANG_OS_WIN
+    // Whether fd takes escapes, not console API calls
+    RANG_INLINE bool writesAnsi(int fd) noexcept;
+#else
+    inline bool writesAnsi(int) noexcept { return true; }
+#endif
+
+    /* Decisions for stdin, stdout and stderr, (epoch << 1) | colorize as
+     * for streams. Other fds get closed and reused for other files, so
+     * they are looked at every time.
+     */
+    inline std::atomic<long> *fdDecisions() noexcept
+    {
+        static std::atomic<long> decisions[3];  // zero initialized
+        return decisions;
+    }
+
+}  // namespace rang_implementation
+
+/* Whether rang output written straight to fd should contain escapes, as
+ * operator<< would decide for a stream writing to fd. For output that
+ * doesn't go through an ostream: std::format, printf or write(2). Cached
+ * for fds 0 to 2 until the next setControlMode or setColorLevel.
+ */
+inline bool shouldColorize(const int fd) noexcept
+{
+    namespace impl   = rang_implementation;
+    const long epoch = impl::controlEpoch().load(std::memory_order_acquire);
+    std::atomic<long> *cached
+      = fd >= 0 && fd < 3 ? &impl::fdDecisions()[fd] : nullptr;
+    if (cached != nullptr) {
+        const long decision = cached->load(std::memory_order_relaxed);
+        if ((decision >> 1) == epoch) {
+            return (decision & 1) != 0;
+        }
+    }
+    bool colorize = false;
+    switch (impl::controlMode().load()) {
+        case control::Auto:
+            colorize = impl::supportsColor()
+              && (cached != nullptr ? impl::isStdTerminal(fd)
+                                    : impl::isTerminalFd(fd))
+              && impl::writesAnsi(fd);
+            break;
+        case control::Force: colorize = impl::writesAnsi(fd); break;
+        default: break;
+    }
+    if (cached != nullptr) {
+        cached->store((epoch << 1) | (colorize ? 1 : 0),
+                      std::memory_order_relaxed);
+    }
+    return colorize;
+}
+
+/* Escape sequence of a style as rang writes it, extended colors
+ * downsampled to the color level, for output that doesn't go through an
+ * ostream. The characters are held inline, building one doesn't allocate.
+ * Constructed with an fd, it is empty unless shouldColorize(fd).
+ */
+class escape {
+public:
+    escape() noexcept : size_(0) {}
+
+    explicit escape(const styleSet &style) noexcept : size_(0)
+    {
+        namespace impl               = rang_implementation;
+        const rang::colorLevel level = impl::colorLevelSetting();
+        if (style.extended() && level != rang::colorLevel::TrueColor
+            && level != rang::colorLevel::None) {
+            unsigned char codes[styleSet::maxCodes];
+            const std::size_t count
+              = impl::downsample(style.codes(), style.count(), level, codes);
+            size_ = static_cast<std::size_t>(
+              impl::writeSequence(data_, codes, count) - data_);
+        } else {
+            size_ = style.size();
+            std::memcpy(data_, style.data(), size_);
+        }
+    }
+
+    escape(const styleSet &style, const int fd) noexcept
+        : escape(shouldColorize(fd) ? style : styleSet())
+    {
+    }
+
+    const char *data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+private:
+    char data_[4 + 4 * styleSet::maxCodes];
+    std::size_t size_;
+};
+
+/* Copies the escape of style to buf if it fits in capacity. Returns its
+ * length either way, like snprintf but without a terminating '\0'.
+ */
+inline std::size_t escapeTo(char *buf, const std::size_t capacity,
+                            const styleSet &style) noexcept
+{
+    const escape seq(style);
+    if (seq.size() <= capacity) {
+        std::memcpy(buf, seq.data(), seq.size());
+    }
+    return seq.size();
+}
+
+namespace rang_implementation {
+
+    // Longest control sequence: CSI, two 10 digit numbers, ';' and final
+    constexpr std::size_t maxControlSize = 24;
+
+    struct controlText {
+        const char *data;
+        unsigned char size;
+    };
+
+    inline controlText textOf(const rang::cursor value) noexcept
+    {
+        static const controlText text[]
+          = { { "\0337", 2 },
+              { "\0338", 2 },
+              { "\033[?25l", 6 },
+              { "\033[?25h", 6 },
+              { "\033[H", 3 } };
+        return text[static_cast<int>(value)];
+    }
+
+    inline controlText textOf(const rang::erase value) noexcept
+    {
+        static const controlText text[]
+          = { { "\033[K", 3 },  { "\033[1K", 4 }, { "\033[2K", 4 },
+              { "\033[J", 3 },  { "\033[1J", 4 }, { "\033[2J", 4 },
+              { "\033[3J", 4 } };
+        return text[static_cast<int>(value)];
+    }
+
+    inline controlText textOf(const rang::screen value) noexcept
+    {
+        static const controlText text[]
+          = { { "\033[?1049h", 8 }, { "\033[?1049l", 8 } };
+        return text[static_cast<int>(value)];
+    }
+
+    template <typename T>
+    struct isControl
+        : std::integral_constant<bool,
+                                 std::is_same<T, rang::cursor>::value
+                                   || std::is_same<T, rang::erase>::value
+                                   || std::is_same<T, rang::screen>::value> {
+    };
+
+    template <char Final>
+    struct isControl<rang::csiCount<Final>> : std::true_type {
+    };
+
+    template <char Final>
+    struct isControl<rang::csiPair<Final>> : std::true_type {
+    };
+
+    // Writes value in decimal, returns the new end
+    inline char *writeNumber(char *out, unsigned value) noexcept
+    {
+        char digits[10];
+        std::size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n != 0) {
+            *out++ = digits[--n];
+        }
+        return out;
+    }
+
+    /* Writes the control sequence of value to out, which has room for
+     * maxControlSize characters, and returns its length. The fixed ones
+     * are copied from tables, counts are encoded on the stack.
+     */
+    template <typename T>
+    inline typename std::enable_if<std::is_enum<T>::value, std::size_t>::type
+    encodeControl(char *out, const T value) noexcept
+    {
+        const controlText text = textOf(value);
+        std::memcpy(out, text.data, text.size);
+        return text.size;
+    }
+
+    template <char Final>
+    inline std::size_t encodeControl(char *out,
+                                     const rang::csiCount<Final> value) noexcept
+    {
+        if (value.n == 0) {
+            return 0;
+        }
+        char *end = out;
+        *end++    = '\033';
+        *end++    = '[';
+        end       = writeNumber(end, value.n);
+        *end++    = Final;
+        return static_cast<std::size_t>(end - out);
+    }
+
+    template <char Final>
+    inline std::size_t encodeControl(char *out,
+                                     const rang::csiPair<Final> value) noexcept
+    {
+        char *end = out;
+        *end++    = '\033';
+        *end++    = '[';
+        if (value.first != 0 || value.second != 0) {
+            end    = writeNumber(end, value.first);
+            *end++ = ';';
+            end    = writeNumber(end, value.second);
+        }
+        *end++ = Final;
+        return static_cast<std::size_t>(end - out);
+    }
+
+}  // namespace rang_implementation
+
+// escapeTo for cursor, erase and screen control
+template <typename T>
+inline typename std::enable_if<rang_implementation::isControl<T>::value,
+                               std::size_t>::type
+escapeTo(char *buf, const std::size_t capacity, const T &value) noexcept
+{
+    char seq[rang_implementation::maxControlSize];
+    const std::size_t size = rang_implementation::encodeControl(seq, value);
+    if (size <= capacity) {
+        std::memcpy(buf, seq, size);
+    }
+    return size;
+}
+
+namespace rang_implementation {
+
+    /* Sets style with the console API when fd is a console that doesn't
+     * take escapes, after flushing what file has buffered for it. False
+     * when fd is no such console or colors are off.
+     */
+    RANG_INLINE bool setConsoleStyle(int fd, const rang::styleSet &style,
+                                     std::FILE *file) noexcept;
+
+    // Writes all of data to fd, false if a write failed
+    RANG_INLINE bool writeFd(int fd, const char *data,
+                             std::size_t size) noexcept;
+
+}  // namespace rang_implementation
+
+/* Writes style to file, an escape if fileno(file) should get colors or a
+ * console API call on Windows consoles without ANSI support. Returns a
+ * non-negative value on success, EOF on error, like std::fputs.
+ */
+inline int fputStyle(const styleSet &style, std::FILE *file) noexcept
+{
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+    const int fd = fileno(file);
+#elif defined(RANG_OS_WIN)
+    const int fd = _fileno(file);
+#endif
+    const escape seq(style, fd);
+    if (seq.empty()) {
+        rang_implementation::setConsoleStyle(fd, style, file);
+        return 0;
+    }
+    return std::fwrite(seq.data(), 1, seq.size(), file) == seq.size() ? 0
+                                                                       : EOF;
+}
+
+// Writes style straight to fd, the same way. False if a write failed
+inline bool writeStyle(const int fd, const styleSet &style) noexcept
+{
+    const escape seq(style, fd);
+    if (seq.empty()) {
+        rang_implementation::setConsoleStyle(fd, style, nullptr);
+        return true;
+    }
+    return rang_implementation::writeFd(fd, seq.data(), seq.size());
+}
+
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+/* Fills out with the pieces of styled text for writev: the escape, the
+ * text and a reset, or only the text when seq is empty. Returns how many
+ * of the 3 entries were used; they point into seq and text.
+ *
+ *   const rang::escape red(rang::fg::red, STDERR_FILENO);
+ *   iovec iov[3];
+ *   writev(STDERR_FILENO, iov, rang::styledIovec(iov, red, msg, len));
+ */
+inline int styledIovec(iovec *out, const escape &seq, const char *text,
+                       const std::size_t size) noexcept
+{
+    static const char reset[] = "\033[0m";
+    if (seq.empty()) {
+        out[0].iov_base = const_cast<char *>(text);
+        out[0].iov_len  = size;
+        return 1;
+    }
+    out[0].iov_base = const_cast<char *>(seq.data());
+    out[0].iov_len  = seq.size();
+    out[1].iov_base = const_cast<char *>(text);
+    out[1].iov_len  = size;
+    out[2].iov_base = const_cast<char *>(reset);
+    out[2].iov_len  = sizeof reset - 1;
+    return 3;
+}
+
+/* Text between style and a reset in a single writev, so it can't be split
+ * by other writers of fd. Returns what writev returned, retrying when a
+ * signal interrupted it before anything was written.
+ */
+inline ssize_t writeStyled(const int fd, const styleSet &style,
+                           const char *text, const std::size_t size) noexcept
+{
+    const escape seq(style, fd);
+    iovec iov[3];
+    const int count = styledIovec(iov, seq, text, size);
+    ssize_t written;
+    do {
+        written = ::writev(fd, iov, count);
+    } while (written < 0 && errno == EINTR);
+    return written;
+}
+#endif
+
+inline void setColorLevel(const colorLevel value) noexcept
+{
+    rang_implementation::colorLevelState() = static_cast<int>(value) + 1;
+    rang_implementation::controlEpoch().fetch_add(1, std::memory_order_release);
+}
+
+inline void setControlMode(const control value) noexcept
+{
+    rang_implementation::controlMode() = value;
+    rang_implementation::controlEpoch().fetch_add(1, std::memory_order_release);
+}
+
+inline void setWinTermMode(const rang::winTerm value) noexcept
+{
+    rang_implementation::winTermMode() = value;
+    rang_implementation::controlEpoch().fetch_add(1, std::memory_order_release);
+}
+
+/* What rang finds out about the process: the color level from the
+ * environment variables and whether stdin, stdout and stderr are
+ * terminals. Probed piecemeal on first use unless init is called.
+ */
+struct environment {
+    colorLevel level;
+    bool terminal[3];
+};
+
+struct initOptions {
+    /* Variable with an environment from exportEnvironment in the parent
+     * process, used instead of probing when set and well formed. nullptr
+     * to always probe.
+     */
+    const char *inherit = "RANG_ENVIRONMENT";
+    // Remove the variable once read, so that processes started from this
+    // one probe for themselves instead of inheriting what held for it
+    bool consume = true;
+};
+
+/* An environment as exportEnvironment writes it: the level digit, 0 to 3,
+ * then 0 or 1 for stdin, stdout and stderr being terminals ("3011"). A
+ * parent written in another language can set it the same way.
+ */
+inline void formatEnvironment(const environment &env, char (&buf)[5]) noexcept
+{
+    buf[0] = static_cast<char>('0' + static_cast<int>(env.level));
+    for (int fd = 0; fd < 3; ++fd) {
+        buf[fd + 1] = env.terminal[fd] ? '1' : '0';
+    }
+    buf[4] = '\0';
+}
+
+inline bool parseEnvironment(const char *value, environment &env) noexcept
+{
+    if (value == nullptr || value[0] < '0' || value[0] > '3') {
+        return false;
+    }
+    for (int fd = 0; fd < 3; ++fd) {
+        if (value[fd + 1] != '0' && value[fd + 1] != '1') {
+            return false;
+        }
+    }
+    if (value[4] != '\0') {
+        return false;
+    }
+    env.level = static_cast<colorLevel>(value[0] - '0');
+    for (int fd = 0; fd < 3; ++fd) {
+        env.terminal[fd] = value[fd + 1] == '1';
+    }
+    return true;
+}
+
+// Probes the environment now, without changing what rang uses
+RANG_INLINE environment probeEnvironment() noexcept;
+
+/* Probes the environment, or takes it from options.inherit, and makes it
+ * what rang uses from then on, so no output pays for detection. Meant for
+ * the start of main, before setColorLevel and before other threads use
+ * rang. Returns the environment, for exportEnvironment.
+ */
+RANG_INLINE environment init(const initOptions &options
+                             = initOptions()) noexcept;
+
+/* Sets the variable init reads, for the processes this one starts. Only
+ * right for children that write to the same stdin, stdout and stderr.
+ * False if the variable couldn't be set.
+ */
+RANG_INLINE bool exportEnvironment(const environment &env,
+                                   const char *name
+                                   = "RANG_ENVIRONMENT") noexcept;
+
+}  // namespace rang
+
+#ifndef RANG_COMPILED
+#include "core-inl.hpp"
+#endif
+
+#endif /* ifndef RANG_CORE_DOT_HPP */
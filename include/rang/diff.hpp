@@ -0,0 +1,688 @@
+#ifndef RANG_DIFF_DOT_HPP
+#define RANG_DIFF_DOT_HPP
+
+#include "mapped.hpp"
+#include "ostream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace rang {
+
+struct diffOptions {
+    std::string fromName = "a";  // names on the --- and +++ lines
+    std::string toName   = "b";
+    unsigned context     = 3;     // unchanged lines around each change
+    bool words           = true;  // mark the changed words of changed lines
+
+    styleSet header       = style::bold;
+    styleSet hunk         = fg::cyan;
+    styleSet removed      = fg::red;
+    styleSet added        = fg::green;
+    styleSet removedWords = bg::red | fg::black;
+    styleSet addedWords   = bg::green | fg::black;
+};
+
+namespace rang_implementation {
+
+    // A line with its '\n', if it has one, and a hash to compare it by
+    struct diffLine {
+        const char *data;
+        std::size_t size;
+        std::uint64_t hash;
+    };
+
+    inline std::uint64_t hashBytes(const char *p,
+                                   const std::size_t size) noexcept
+    {
+        std::uint64_t hash = 0xCBF29CE484222325ULL;  // FNV-1a
+        for (std::size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(p[i]))
+              * 0x100000001B3ULL;
+        }
+        return hash;
+    }
+
+    inline void splitLines(const char *text, const std::size_t size,
+                           std::vector<diffLine> &lines)
+    {
+        const char *p   = text;
+        const char *end = text + size;
+        while (p != end) {
+            const void *nl
+              = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+            const char *next
+              = nl != nullptr ? static_cast<const char *>(nl) + 1 : end;
+            const std::size_t length = static_cast<std::size_t>(next - p);
+            lines.push_back({ p, length, hashBytes(p, length) });
+            p = next;
+        }
+    }
+
+    inline bool sameLine(const diffLine &a, const diffLine &b) noexcept
+    {
+        return a.hash == b.hash && a.size == b.size
+          && std::memcmp(a.data, b.data, a.size) == 0;
+    }
+
+    /* Numbers the lines of a and b so that equal lines, and only those,
+     * get the same number, for the search to compare numbers.
+     */
+    inline void numberLines(const std::vector<diffLine> &a,
+                            const std::vector<diffLine> &b,
+                            std::vector<std::uint32_t> &aIds,
+                            std::vector<std::uint32_t> &bIds)
+    {
+        std::size_t capacity = 16;
+        while (capacity < 2 * (a.size() + b.size())) {
+            capacity <<= 1;
+        }
+        // Open addressing on the hashes, each slot the first line seen
+        std::vector<const diffLine *> slots(capacity, nullptr);
+        std::vector<std::uint32_t> slotIds(capacity);
+        std::uint32_t next = 0;
+        const auto number  = [&](const diffLine &line) {
+            std::size_t i = static_cast<std::size_t>(line.hash)
+              & (capacity - 1);
+            while (slots[i] != nullptr) {
+                if (sameLine(*slots[i], line)) {
+                    return slotIds[i];
+                }
+                i = (i + 1) & (capacity - 1);
+            }
+            slots[i]   = &line;
+            slotIds[i] = next;
+            return next++;
+        };
+        aIds.resize(a.size());
+        bIds.resize(b.size());
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            aIds[i] = number(a[i]);
+        }
+        for (std::size_t i = 0; i < b.size(); ++i) {
+            bIds[i] = number(b[i]);
+        }
+    }
+
+    /* Myers' O((N+M)D) difference algorithm in linear space: the middle
+     * snake of each range is found searching from both ends, and the two
+     * halves around it are compared the same way. equal(x, y) compares
+     * element x of a with element y of b. Past tooExpensive steps the
+     * search settles for the furthest point reached, like GNU diff does,
+     * so unrelated inputs still take about linear time but may get a
+     * longer than minimal script.
+     */
+    template <typename Equal>
+    class myersDiff {
+    public:
+        myersDiff(const std::ptrdiff_t n, const std::ptrdiff_t m,
+                  const Equal &equal)
+            : equal_(equal)
+            , n_(n)
+            , m_(m)
+            , diagonals_(2 * static_cast<std::size_t>(n + m + 3))
+            , tooExpensive_(4096)
+        {
+            fd_ = diagonals_.data() + m + 1;
+            bd_ = fd_ + n + m + 3;
+            std::ptrdiff_t expensive = 1;
+            for (std::ptrdiff_t d = n + m + 3; d != 0; d >>= 2) {
+                expensive <<= 1;
+            }
+            tooExpensive_ = expensive > tooExpensive_ ? expensive
+                                                      : tooExpensive_;
+        }
+
+        // Sets removed[x] for elements of a and added[y] for elements of b
+        void run(std::vector<char> &removed, std::vector<char> &added)
+        {
+            removed.assign(static_cast<std::size_t>(n_), 0);
+            added.assign(static_cast<std::size_t>(m_), 0);
+            removed_ = removed.data();
+            added_   = added.data();
+            compare(0, n_, 0, m_);
+        }
+
+    private:
+        void compare(std::ptrdiff_t xoff, std::ptrdiff_t xlim,
+                     std::ptrdiff_t yoff, std::ptrdiff_t ylim)
+        {
+            while (xoff < xlim && yoff < ylim && equal_(xoff, yoff)) {
+                ++xoff;
+                ++yoff;
+            }
+            while (xoff < xlim && yoff < ylim
+                   && equal_(xlim - 1, ylim - 1)) {
+                --xlim;
+                --ylim;
+            }
+            if (xoff == xlim) {
+                std::memset(added_ + yoff, 1,
+                            static_cast<std::size_t>(ylim - yoff));
+            } else if (yoff == ylim) {
+                std::memset(removed_ + xoff, 1,
+                            static_cast<std::size_t>(xlim - xoff));
+            } else {
+                std::ptrdiff_t xmid;
+                std::ptrdiff_t ymid;
+                split(xoff, xlim, yoff, ylim, xmid, ymid);
+                compare(xoff, xmid, yoff, ymid);
+                compare(xmid, xlim, ymid, ylim);
+            }
+        }
+
+        // A point on a shortest path through the range, fd_ and bd_ hold
+        // the furthest x reached on each diagonal x - y
+        void split(const std::ptrdiff_t xoff, const std::ptrdiff_t xlim,
+                   const std::ptrdiff_t yoff, const std::ptrdiff_t ylim,
+                   std::ptrdiff_t &xmid, std::ptrdiff_t &ymid)
+        {
+            const std::ptrdiff_t none
+              = (std::numeric_limits<std::ptrdiff_t>::max)();
+            const std::ptrdiff_t dmin = xoff - ylim;
+            const std::ptrdiff_t dmax = xlim - yoff;
+            const std::ptrdiff_t fmid = xoff - yoff;
+            const std::ptrdiff_t bmid = xlim - ylim;
+            const bool odd            = ((fmid - bmid) & 1) != 0;
+            std::ptrdiff_t fmin       = fmid;
+            std::ptrdiff_t fmax       = fmid;
+            std::ptrdiff_t bmin       = bmid;
+            std::ptrdiff_t bmax       = bmid;
+            fd_[fmid]                 = xoff;
+            bd_[bmid]                 = xlim;
+
+            for (std::ptrdiff_t c = 1;; ++c) {
+                if (fmin > dmin) {
+                    fd_[--fmin - 1] = -1;
+                } else {
+                    ++fmin;
+                }
+                if (fmax < dmax) {
+                    fd_[++fmax + 1] = -1;
+                } else {
+                    --fmax;
+                }
+                for (std::ptrdiff_t d = fmax; d >= fmin; d -= 2) {
+                    const std::ptrdiff_t low  = fd_[d - 1];
+                    const std::ptrdiff_t high = fd_[d + 1];
+                    std::ptrdiff_t x          = low < high ? high : low + 1;
+                    std::ptrdiff_t y          = x - d;
+                    while (x < xlim && y < ylim && equal_(x, y)) {
+                        ++x;
+                        ++y;
+                    }
+                    fd_[d] = x;
+                    if (odd && bmin <= d && d <= bmax && bd_[d] <= x) {
+                        xmid = x;
+                        ymid = y;
+                        return;
+                    }
+                }
+
+                if (bmin > dmin) {
+                    bd_[--bmin - 1] = none;
+                } else {
+                    ++bmin;
+                }
+                if (bmax < dmax) {
+                    bd_[++bmax + 1] = none;
+                } else {
+                    --bmax;
+                }
+                for (std::ptrdiff_t d = bmax; d >= bmin; d -= 2) {
+                    const std::ptrdiff_t low  = bd_[d - 1];
+                    const std::ptrdiff_t high = bd_[d + 1];
+                    std::ptrdiff_t x          = low < high ? low : high - 1;
+                    std::ptrdiff_t y          = x - d;
+                    while (x > xoff && y > yoff && equal_(x - 1, y - 1)) {
+                        --x;
+                        --y;
+                    }
+                    bd_[d] = x;
+                    if (!odd && fmin <= d && d <= fmax && x <= fd_[d]) {
+                        xmid = x;
+                        ymid = y;
+                        return;
+                    }
+                }
+
+                if (c >= tooExpensive_) {
+                    settle(xoff, xlim, yoff, ylim, fmin, fmax, bmin, bmax,
+                           xmid, ymid);
+                    return;
+                }
+            }
+        }
+
+        // The furthest point either search reached, measured by x + y
+        void settle(const std::ptrdiff_t xoff, const std::ptrdiff_t xlim,
+                    const std::ptrdiff_t yoff, const std::ptrdiff_t ylim,
+                    const std::ptrdiff_t fmin, const std::ptrdiff_t fmax,
+                    const std::ptrdiff_t bmin, const std::ptrdiff_t bmax,
+                    std::ptrdiff_t &xmid, std::ptrdiff_t &ymid) const
+        {
+            std::ptrdiff_t fxy = -1;
+            std::ptrdiff_t fx  = 0;
+            for (std::ptrdiff_t d = fmax; d >= fmin; d -= 2) {
+                std::ptrdiff_t x = fd_[d] < xlim ? fd_[d] : xlim;
+                std::ptrdiff_t y = x - d;
+                if (y > ylim) {
+                    x = ylim + d;
+                    y = ylim;
+                }
+                if (x + y > fxy) {
+                    fxy = x + y;
+                    fx  = x;
+                }
+            }
+            std::ptrdiff_t bxy = (std::numeric_limits<std::ptrdiff_t>::max)();
+            std::ptrdiff_t bx  = 0;
+            for (std::ptrdiff_t d = bmax; d >= bmin; d -= 2) {
+                std::ptrdiff_t x = bd_[d] > xoff ? bd_[d] : xoff;
+                std::ptrdiff_t y = x - d;
+                if (y < yoff) {
+                    x = yoff + d;
+                    y = yoff;
+                }
+                if (x + y < bxy) {
+                    bxy = x + y;
+                    bx  = x;
+                }
+            }
+            if ((xlim + ylim) - bxy < fxy - (xoff + yoff)) {
+                xmid = fx;
+                ymid = fxy - fx;
+            } else {
+                xmid = bx;
+                ymid = bxy - bx;
+            }
+        }
+
+        const Equal &equal_;
+        const std::ptrdiff_t n_;
+        const std::ptrdiff_t m_;
+        std::vector<std::ptrdiff_t> diagonals_;
+        std::ptrdiff_t *fd_;
+        std::ptrdiff_t *bd_;
+        std::ptrdiff_t tooExpensive_;
+        char *removed_;
+        char *added_;
+    };
+
+    template <typename Equal>
+    inline void diffSequences(const std::ptrdiff_t n, const std::ptrdiff_t m,
+                              const Equal &equal, std::vector<char> &removed,
+                              std::vector<char> &added)
+    {
+        myersDiff<Equal>(n, m, equal).run(removed, added);
+    }
+
+    // Words, runs of blanks and single other characters of a line
+    inline void splitWords(const char *p, const std::size_t size,
+                           std::vector<diffLine> &words)
+    {
+        words.clear();
+        const char *end = p + size;
+        while (p != end) {
+            const char *start = p;
+            const unsigned char c = static_cast<unsigned char>(*p);
+            if (c >= 0x80 || c == '_' || (c >= '0' && c <= '9')
+                || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')) {
+                do {
+                    ++p;
+                } while (p != end
+                         && (static_cast<unsigned char>(*p) >= 0x80
+                             || *p == '_' || (*p >= '0' && *p <= '9')
+                             || ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'z')));
+            } else if (c == ' ' || c == '\t') {
+                do {
+                    ++p;
+                } while (p != end && (*p == ' ' || *p == '\t'));
+            } else {
+                ++p;
+            }
+            words.push_back({ start, static_cast<std::size_t>(p - start),
+                              0 });
+        }
+    }
+
+    /* Writes a unified diff of two line lists to os through a 64 KiB
+     * buffer, colored when os gets colors.
+     */
+    class diffWriter {
+    public:
+        diffWriter(std::ostream &os, const diffOptions &options)
+            : os_(os)
+            , options_(options)
+            , colors_(shouldColorize(os) && writesAnsi(os))
+        {
+            if (colors_) {
+                header_       = escape(options.header);
+                hunk_         = escape(options.hunk);
+                removed_      = escape(options.removed);
+                added_        = escape(options.added);
+                removedWords_ = escape(options.removedWords);
+                addedWords_   = escape(options.addedWords);
+            }
+        }
+
+        diffWriter(const diffWriter &) = delete;
+        diffWriter &operator=(const diffWriter &) = delete;
+
+        ~diffWriter() { flush(); }
+
+        // Returns whether the lists differ
+        bool write(const std::vector<diffLine> &a,
+                   const std::vector<diffLine> &b)
+        {
+            std::vector<std::uint32_t> aIds;
+            std::vector<std::uint32_t> bIds;
+            numberLines(a, b, aIds, bIds);
+            std::vector<char> removed;
+            std::vector<char> added;
+            const auto equal = [&aIds, &bIds](const std::ptrdiff_t x,
+                                              const std::ptrdiff_t y) {
+                return aIds[static_cast<std::size_t>(x)]
+                  == bIds[static_cast<std::size_t>(y)];
+            };
+            diffSequences(static_cast<std::ptrdiff_t>(a.size()),
+                          static_cast<std::ptrdiff_t>(b.size()), equal,
+                          removed, added);
+
+            // Changes: lines a0..a1 of a replaced by b0..b1 of b
+            std::vector<change> changes;
+            std::size_t i = 0;
+            std::size_t j = 0;
+            while (i < a.size() || j < b.size()) {
+                if (i < a.size() && j < b.size() && !removed[i]
+                    && !added[j]) {
+                    ++i;
+                    ++j;
+                    continue;
+                }
+                change next = { i, i, j, j };
+                while (i < a.size() && removed[i]) {
+                    ++i;
+                }
+                while (j < b.size() && added[j]) {
+                    ++j;
+                }
+                next.a1 = i;
+                next.b1 = j;
+                changes.push_back(next);
+            }
+            if (changes.empty()) {
+                return false;
+            }
+
+            line(header_, "--- " + options_.fromName + '\n');
+            line(header_, "+++ " + options_.toName + '\n');
+            const std::size_t context = options_.context;
+            for (std::size_t first = 0; first < changes.size();) {
+                std::size_t last = first;
+                while (last + 1 < changes.size()
+                       && changes[last + 1].a0 - changes[last].a1
+                         <= 2 * context) {
+                    ++last;
+                }
+                writeHunk(a, b, changes, first, last);
+                first = last + 1;
+            }
+            return true;
+        }
+
+        void flush()
+        {
+            if (!out_.empty()) {
+                os_.write(out_.data(), static_cast<std::streamsize>(
+                                         out_.size()));
+                out_.clear();
+            }
+        }
+
+    private:
+        struct change {
+            std::size_t a0;
+            std::size_t a1;
+            std::size_t b0;
+            std::size_t b1;
+        };
+
+        static constexpr std::size_t bufferSize = 64 * 1024;
+
+        void line(const escape &style, const std::string &text)
+        {
+            if (!style.empty()) {
+                out_.append(style.data(), style.size());
+                out_.append(text, 0, text.size() - 1);
+                out_ += "\033[0m\n";
+            } else {
+                out_ += text;
+            }
+        }
+
+        // A line of a or b after its prefix, "\ No newline" if it has none
+        static void body(std::string &out, const char prefix,
+                         const escape &style, const diffLine &text)
+        {
+            const bool newline
+              = text.size != 0 && text.data[text.size - 1] == '\n';
+            out.append(style.data(), style.size());
+            out += prefix;
+            out.append(text.data, text.size - (newline ? 1 : 0));
+            if (!style.empty()) {
+                out += "\033[0m";
+            }
+            out += newline ? "\n" : "\n\\ No newline at end of file\n";
+        }
+
+        /* Writes a removed line to out_ and the line that replaced it to
+         * added_ with their changed words marked, or returns false if they
+         * share no words.
+         */
+        bool wordPair(const diffLine &from, const diffLine &to)
+        {
+            splitWords(from.data, from.size, fromWords_);
+            splitWords(to.data, to.size, toWords_);
+            const auto equal = [this](const std::ptrdiff_t x,
+                                      const std::ptrdiff_t y) {
+                const diffLine &u = fromWords_[static_cast<std::size_t>(x)];
+                const diffLine &v = toWords_[static_cast<std::size_t>(y)];
+                return u.size == v.size
+                  && std::memcmp(u.data, v.data, u.size) == 0;
+            };
+            diffSequences(static_cast<std::ptrdiff_t>(fromWords_.size()),
+                          static_cast<std::ptrdiff_t>(toWords_.size()),
+                          equal, fromChanged_, toChanged_);
+            bool shared = false;
+            for (std::size_t i = 0; i < fromWords_.size() && !shared; ++i) {
+                const char c = fromWords_[i].data[0];
+                shared = !fromChanged_[i] && c != ' ' && c != '\t'
+                  && c != '\n';
+            }
+            if (!shared) {
+                return false;
+            }
+            markedBody(out_, '-', removed_, removedWords_, fromWords_,
+                       fromChanged_);
+            markedBody(addedLines_, '+', added_, addedWords_, toWords_,
+                       toChanged_);
+            return true;
+        }
+
+        static void markedBody(std::string &out, const char prefix,
+                               const escape &style, const escape &marked,
+                               const std::vector<diffLine> &words,
+                               const std::vector<char> &changed)
+        {
+            out.append(style.data(), style.size());
+            out += prefix;
+            bool marking = false;
+            bool newline = false;
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                const diffLine &word = words[i];
+                if (i + 1 == words.size() && word.data[0] == '\n') {
+                    newline = true;
+                    break;
+                }
+                const bool mark = changed[i] != 0;
+                if (mark != marking) {
+                    out += "\033[0m";
+                    const escape &next = mark ? marked : style;
+                    out.append(next.data(), next.size());
+                    marking = mark;
+                }
+                out.append(word.data, word.size);
+            }
+            out += "\033[0m";
+            out += newline ? "\n" : "\n\\ No newline at end of file\n";
+        }
+
+        void writeHunk(const std::vector<diffLine> &a,
+                       const std::vector<diffLine> &b,
+                       const std::vector<change> &changes,
+                       const std::size_t first, const std::size_t last)
+        {
+            const std::size_t context = options_.context;
+            const change &begin       = changes[first];
+            const change &end         = changes[last];
+            const std::size_t lead
+              = begin.a0 < context ? begin.a0 : context;
+            const std::size_t trail
+              = a.size() - end.a1 < context ? a.size() - end.a1 : context;
+            const std::size_t a0 = begin.a0 - lead;
+            const std::size_t b0 = begin.b0 - lead;
+            const std::size_t a1 = end.a1 + trail;
+            const std::size_t b1 = end.b1 + trail;
+
+            std::string range = "@@ -" + hunkRange(a0, a1 - a0) + " +"
+              + hunkRange(b0, b1 - b0) + " @@\n";
+            line(hunk_, range);
+
+            std::size_t i = a0;
+            for (std::size_t k = first; k <= last; ++k) {
+                const change &c = changes[k];
+                for (; i < c.a0; ++i) {
+                    body(out_, ' ', none_, a[i]);
+                }
+                // Lines replaced one for one get their changed words
+                // marked, the added ones still follow the removed ones
+                const bool paired
+                  = colors_ && options_.words && c.a1 - c.a0 == c.b1 - c.b0;
+                for (std::size_t x = c.a0, y = c.b0; x < c.a1; ++x, ++y) {
+                    if (!paired || !wordPair(a[x], b[y])) {
+                        body(out_, '-', removed_, a[x]);
+                        if (paired) {
+                            body(addedLines_, '+', added_, b[y]);
+                        }
+                    }
+                    if (out_.size() >= bufferSize) {
+                        flush();
+                    }
+                }
+                for (std::size_t y = c.b0; !paired && y < c.b1; ++y) {
+                    body(out_, '+', added_, b[y]);
+                    if (out_.size() >= bufferSize) {
+                        flush();
+                    }
+                }
+                out_ += addedLines_;
+                addedLines_.clear();
+                i = c.a1;
+            }
+            for (; i < a1; ++i) {
+                body(out_, ' ', none_, a[i]);
+            }
+            if (out_.size() >= bufferSize) {
+                flush();
+            }
+        }
+
+        // start,count of a hunk, 1 based; an empty range names the line
+        // before it
+        static std::string hunkRange(const std::size_t start,
+                                     const std::size_t count)
+        {
+            if (count == 1) {
+                return std::to_string(start + 1);
+            }
+            return std::to_string(count == 0 ? start : start + 1) + ','
+              + std::to_string(count);
+        }
+
+        std::ostream &os_;
+        const diffOptions &options_;
+        const bool colors_;
+        escape header_;
+        escape hunk_;
+        escape removed_;
+        escape added_;
+        escape removedWords_;
+        escape addedWords_;
+        const escape none_;
+        std::string out_;
+        std::string addedLines_;  // added lines of a change being paired
+
+        // Reused between changed line pairs
+        std::vector<diffLine> fromWords_;
+        std::vector<diffLine> toWords_;
+        std::vector<char> fromChanged_;
+        std::vector<char> toChanged_;
+    };
+
+}  // namespace rang_implementation
+
+/* Writes a unified diff from text from to text to, returning whether
+ * they differ; nothing is written when they don't:
+ *
+ *   rang::diff(std::cout, before.data(), before.size(), after.data(),
+ *              after.size());
+ *
+ * Lines are compared by hash, and the common start and end are skipped
+ * before the Myers search, which runs in space linear in the line count.
+ * With colors, deciding like operator<<, removed lines are red, added
+ * ones green, and lines changed in place have their changed words marked
+ * with a background. Output goes to os in pieces of about 64 KiB.
+ */
+inline bool diff(std::ostream &os, const char *from,
+                 const std::size_t fromSize, const char *to,
+                 const std::size_t toSize,
+                 const diffOptions &options = diffOptions())
+{
+    namespace impl = rang_implementation;
+    std::vector<impl::diffLine> a;
+    std::vector<impl::diffLine> b;
+    impl::splitLines(from, fromSize, a);
+    impl::splitLines(to, toSize, b);
+    impl::diffWriter writer(os, options);
+    return writer.write(a, b);
+}
+
+/* diff of two files, mapped rather than read, named by their paths.
+ * Returns 0 if they are the same, 1 if they differ and 2 if either
+ * can't be read, like diff(1).
+ */
+inline int diffFiles(std::ostream &os, const char *fromPath,
+                     const char *toPath,
+                     const diffOptions &options = diffOptions())
+{
+    const mappedFile from(fromPath);
+    const mappedFile to(toPath);
+    if (!from.valid() || !to.valid()) {
+        return 2;
+    }
+    diffOptions named = options;
+    named.fromName    = fromPath;
+    named.toName      = toPath;
+    return diff(os, from.data(), from.size(), to.data(), to.size(), named)
+      ? 1
+      : 0;
+}
+
+}  // namespace rang
+
+#endif /* ifndef RANG_DIFF_DOT_HPP */
@@ -0,0 +1,227 @@
+#ifndef RANG_FORMAT_DOT_HPP
+#define RANG_FORMAT_DOT_HPP
+
+/* Formatters for rang attributes and styled values, for std::format with
+ * C++20 and for {fmt} when fmt/format.h is included before this header:
+ *
+ *   std::format("{}failed{}", rang::fg::red, rang::style::reset);
+ *   fmt::format_to(buf, "{:>8.2f}", rang::styled(ms, rang::fg::green));
+ *
+ * Escapes are written straight to the output iterator. Whether they are
+ * written is decided per thread, like for stdout unless a formatScope
+ * says otherwise, so formatting needs neither a stream nor an allocation.
+ */
+
+#include "core.hpp"
+
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include(<format>)                                                    \
+  && (__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#include <format>
+#endif
+#endif
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304L
+#define RANG_FORMAT_CONSTEXPR constexpr
+#else
+#define RANG_FORMAT_CONSTEXPR
+#endif
+
+namespace rang {
+
+// A copy of a value formatted with its format spec, between style and a reset
+template <typename T>
+struct styledValue {
+    T value;
+    styleSet style;
+};
+
+// String literals are kept as pointers
+template <typename T>
+inline styledValue<typename std::decay<const T>::type>
+styled(const T &value, const styleSet &style)
+{
+    return { value, style };
+}
+
+namespace rang_implementation {
+
+    // -1 for the stdout decision, else whether to write escapes
+    inline int &formatOverride() noexcept
+    {
+        static thread_local int colors = -1;
+        return colors;
+    }
+
+    inline bool formatColors() noexcept
+    {
+        const int colors = formatOverride();
+        return colors >= 0 ? colors != 0 : rang::shouldColorize(1);
+    }
+
+    template <typename Out>
+    inline Out copyChars(const char *begin, const char *end, Out out)
+    {
+        for (; begin != end; ++begin) {
+            *out++ = *begin;
+        }
+        return out;
+    }
+
+    // The escape sequence of style, downsampled like operator<< does
+    template <typename Out>
+    inline Out formatStyle(const rang::styleSet &style, Out out)
+    {
+        const rang::escape seq(style);
+        return copyChars(seq.data(), seq.data() + seq.size(), out);
+    }
+
+    template <typename Out>
+    inline Out formatReset(Out out)
+    {
+        static const char reset[] = "\033[0m";
+        return copyChars(reset, reset + 4, out);
+    }
+
+    // Formatter of attributes, which take no format spec
+    template <typename T, typename Error>
+    struct styleFormatter {
+        template <typename ParseContext>
+        RANG_FORMAT_CONSTEXPR auto parse(ParseContext &ctx)
+          -> decltype(ctx.begin())
+        {
+            auto it = ctx.begin();
+            if (it != ctx.end() && *it != '}') {
+                throw Error("rang attributes take no format spec");
+            }
+            return it;
+        }
+
+        template <typename FormatContext>
+        auto format(const T &value, FormatContext &ctx) const
+          -> decltype(ctx.out())
+        {
+            if (!formatColors()) {
+                return ctx.out();
+            }
+            return formatStyle(rang::styleSet(value), ctx.out());
+        }
+    };
+
+    // Formatter of styled values, Base formats the value itself
+    template <typename T, typename Base>
+    struct styledFormatter : Base {
+        template <typename FormatContext>
+        auto format(const rang::styledValue<T> &styled,
+                    FormatContext &ctx) const -> decltype(ctx.out())
+        {
+            const bool colors = formatColors() && !styled.style.empty();
+            if (colors) {
+                ctx.advance_to(formatStyle(styled.style, ctx.out()));
+            }
+            auto out = Base::format(styled.value, ctx);
+            return colors ? formatReset(out) : out;
+        }
+    };
+
+}  // namespace rang_implementation
+
+/* Decides for the lifetime of the scope whether rang values formatted on
+ * this thread get escapes: like for fd, or as the control mode says
+ * (Auto meaning like for stdout). Scopes nest.
+ */
+class formatScope {
+public:
+    explicit formatScope(const int fd)
+        : saved_(rang_implementation::formatOverride())
+    {
+        rang_implementation::formatOverride() = shouldColorize(fd) ? 1 : 0;
+    }
+
+    explicit formatScope(const control mode)
+        : saved_(rang_implementation::formatOverride())
+    {
+        rang_implementation::formatOverride()
+          = mode == control::Auto ? -1 : mode == control::Force ? 1 : 0;
+    }
+
+    formatScope(const formatScope &) = delete;
+    formatScope &operator=(const formatScope &) = delete;
+
+    ~formatScope() { rang_implementation::formatOverride() = saved_; }
+
+private:
+    int saved_;
+};
+
+}  // namespace rang
+
+#if defined(__cpp_lib_format)
+
+namespace std {
+
+#define RANG_STD_FORMATTER(T)                                                  \
+    template <>                                                                \
+    struct formatter<T, char>                                                  \
+        : rang::rang_implementation::styleFormatter<T, format_error> {         \
+    };
+
+RANG_STD_FORMATTER(rang::style)
+RANG_STD_FORMATTER(rang::fg)
+RANG_STD_FORMATTER(rang::bg)
+RANG_STD_FORMATTER(rang::fgB)
+RANG_STD_FORMATTER(rang::bgB)
+RANG_STD_FORMATTER(rang::fgRgb)
+RANG_STD_FORMATTER(rang::bgRgb)
+RANG_STD_FORMATTER(rang::fg256)
+RANG_STD_FORMATTER(rang::bg256)
+RANG_STD_FORMATTER(rang::styleSet)
+
+#undef RANG_STD_FORMATTER
+
+template <typename T>
+struct formatter<rang::styledValue<T>, char>
+    : rang::rang_implementation::styledFormatter<T, formatter<T, char>> {
+};
+
+}  // namespace std
+
+#endif
+
+#if defined(FMT_VERSION)
+
+namespace fmt {
+
+#define RANG_FMT_FORMATTER(T)                                                  \
+    template <>                                                                \
+    struct formatter<T>                                                        \
+        : rang::rang_implementation::styleFormatter<T, format_error> {         \
+    };
+
+RANG_FMT_FORMATTER(rang::style)
+RANG_FMT_FORMATTER(rang::fg)
+RANG_FMT_FORMATTER(rang::bg)
+RANG_FMT_FORMATTER(rang::fgB)
+RANG_FMT_FORMATTER(rang::bgB)
+RANG_FMT_FORMATTER(rang::fgRgb)
+RANG_FMT_FORMATTER(rang::bgRgb)
+RANG_FMT_FORMATTER(rang::fg256)
+RANG_FMT_FORMATTER(rang::bg256)
+RANG_FMT_FORMATTER(rang::styleSet)
+
+#undef RANG_FMT_FORMATTER
+
+template <typename T>
+struct formatter<rang::styledValue<T>>
+    : rang::rang_implementation::styledFormatter<T, formatter<T>> {
+};
+
+}  // namespace fmt
+
+#endif
+
+#undef RANG_FORMAT_CONSTEXPR
+
+#endif /* ifndef RANG_FORMAT_DOT_HPP */
@@ -0,0 +1,226 @@
+#ifndef RANG_FWD_DOT_HPP
+#define RANG_FWD_DOT_HPP
+
+/* The attribute enums and color types, and declarations of rang's classes,
+ * for headers that only need to name them. rang/core.hpp writes escapes
+ * without iostreams, rang/ostream.hpp or rang.hpp adds the streams.
+ */
+
+#if defined(__unix__) || defined(__unix) || defined(__linux__)
+#define RANG_OS_LINUX
+#elif defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+#define RANG_OS_WIN
+#elif defined(__APPLE__) || defined(__MACH__)
+#define RANG_OS_MAC
+#else
+#error Unknown Platform
+#endif
+
+/* With RANG_COMPILED the detection and platform code (the *-inl.hpp
+ * headers) is built once into the rang library from src/rang.cpp instead
+ * of being inline in every translation unit.
+ */
+#ifdef RANG_COMPILED
+#define RANG_INLINE
+#else
+#define RANG_INLINE inline
+#endif
+
+#include <cstdint>
+
+namespace rang {
+
+/* For better compability with most of terminals do not use any style settings
+ * except of reset, bold and reversed.
+ * Note that on Windows terminals bold style is same as fgB color.
+ */
+enum class style {
+    reset     = 0,
+    bold      = 1,
+    dim       = 2,
+    italic    = 3,
+    underline = 4,
+    blink     = 5,
+    rblink    = 6,
+    reversed  = 7,
+    conceal   = 8,
+    crossed   = 9
+};
+
+enum class fg {
+    black   = 30,
+    red     = 31,
+    green   = 32,
+    yellow  = 33,
+    blue    = 34,
+    magenta = 35,
+    cyan    = 36,
+    gray    = 37,
+    reset   = 39
+};
+
+enum class bg {
+    black   = 40,
+    red     = 41,
+    green   = 42,
+    yellow  = 43,
+    blue    = 44,
+    magenta = 45,
+    cyan    = 46,
+    gray    = 47,
+    reset   = 49
+};
+
+enum class fgB {
+    black   = 90,
+    red     = 91,
+    green   = 92,
+    yellow  = 93,
+    blue    = 94,
+    magenta = 95,
+    cyan    = 96,
+    gray    = 97
+};
+
+enum class bgB {
+    black   = 100,
+    red     = 101,
+    green   = 102,
+    yellow  = 103,
+    blue    = 104,
+    magenta = 105,
+    cyan    = 106,
+    gray    = 107
+};
+
+/* 24-bit and 256 color palette counterparts of fg and bg, e.g.
+ *   std::cout << rang::fgRgb(255, 135, 0) << rang::bg256(238);
+ */
+struct fgRgb {
+    constexpr fgRgb(const std::uint8_t red, const std::uint8_t green,
+                    const std::uint8_t blue) noexcept
+        : r(red), g(green), b(blue)
+    {
+    }
+    std::uint8_t r, g, b;
+};
+
+struct bgRgb {
+    constexpr bgRgb(const std::uint8_t red, const std::uint8_t green,
+                    const std::uint8_t blue) noexcept
+        : r(red), g(green), b(blue)
+    {
+    }
+    std::uint8_t r, g, b;
+};
+
+struct fg256 {
+    constexpr explicit fg256(const std::uint8_t paletteIndex) noexcept
+        : index(paletteIndex)
+    {
+    }
+    std::uint8_t index;
+};
+
+struct bg256 {
+    constexpr explicit bg256(const std::uint8_t paletteIndex) noexcept
+        : index(paletteIndex)
+    {
+    }
+    std::uint8_t index;
+};
+
+/* Cursor, erase and screen control, written by operator<< like colors
+ * (see setControlMode) but whatever the color level, e.g.
+ *   std::cout << rang::cursorUp(2) << rang::erase::line << "done";
+ */
+enum class cursor {
+    save    = 0,
+    restore = 1,
+    hide    = 2,
+    show    = 3,
+    home    = 4
+};
+
+enum class erase {
+    lineEnd     = 0,  // from the cursor to the end of the line
+    lineStart   = 1,
+    line        = 2,
+    screenEnd   = 3,  // from the cursor to the end of the screen
+    screenStart = 4,
+    screen      = 5,
+    scrollback  = 6
+};
+
+enum class screen {
+    alternate = 0,  // switch to the alternate screen, full screen programs
+    main      = 1
+};
+
+// A control sequence with one count, Final picks the command. Counts of 0
+// write nothing, rows and columns start at 1
+template <char Final>
+struct csiCount {
+    constexpr explicit csiCount(const unsigned count) noexcept : n(count) {}
+    unsigned n;
+};
+
+using cursorUp      = csiCount<'A'>;
+using cursorDown    = csiCount<'B'>;
+using cursorForward = csiCount<'C'>;
+using cursorBack    = csiCount<'D'>;
+using cursorColumn  = csiCount<'G'>;
+using scrollUp      = csiCount<'S'>;
+using scrollDown    = csiCount<'T'>;
+
+// A control sequence with two parameters, none when both are 0
+template <char Final>
+struct csiPair {
+    constexpr csiPair() noexcept : first(0), second(0) {}
+    constexpr csiPair(const unsigned a, const unsigned b) noexcept
+        : first(a), second(b)
+    {
+    }
+    unsigned first, second;
+};
+
+using cursorTo     = csiPair<'H'>;  // row, column
+using scrollRegion = csiPair<'r'>;  // top and bottom row, () for all
+
+enum class control {  // Behaviour of rang function calls
+    Off   = 0,  // toggle off rang style/color calls
+    Auto  = 1,  // (Default) autodect terminal and colorize if needed
+    Force = 2  // force ansi color output to non terminal streams
+};
+// Use rang::setControlMode to set rang control mode
+
+enum class winTerm {  // Windows Terminal Mode
+    Auto   = 0,  // (Default) automatically detects wheter Ansi or Native API
+    Ansi   = 1,  // Force use Ansi API
+    Native = 2  // Force use Native API
+};
+// Use rang::setWinTermMode to explicitly set terminal API for Windows
+// Calling rang::setWinTermMode have no effect on other OS
+
+enum class colorLevel {  // Colors the terminal can display
+    None      = 0,  // no colors, Auto mode writes plain text
+    Ansi16    = 1,  // fg, bg, fgB and bgB, extended colors map to these
+    Ansi256   = 2,  // 256 color palette, 24-bit colors map to it
+    TrueColor = 3  // everything is written as is
+};
+// Detected once from NO_COLOR, FORCE_COLOR, TERM and COLORTERM, or by init
+// Use rang::setColorLevel to override the detection
+
+class styleSet;
+class escape;
+class colorbuf;
+class stripbuf;
+class controlScope;
+class line;
+
+template <int... Codes>
+struct ansiSeq;
+
+}  // namespace rang
+
+#endif /* ifndef RANG_FWD_DOT_HPP */
@@ -0,0 +1,504 @@
+#ifndef RANG_HIGHLIGHT_DOT_HPP
+#define RANG_HIGHLIGHT_DOT_HPP
+
+#include "ostream.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#endif
+
+namespace rang {
+
+enum class syntax {  // What highlight and tokenize read
+    json     = 0,
+    keyValue = 1,  // logfmt style lines: level=error msg="disk full"
+    cLike    = 2   // C, C++, Java, JavaScript and the like
+};
+
+enum class token : unsigned char {
+    text        = 0,  // whitespace and anything else
+    key         = 1,  // JSON object keys, the k of k=v
+    string      = 2,
+    number      = 3,
+    keyword     = 4,  // true, false, null; C keywords and directives
+    punctuation = 5,
+    comment     = 6
+};
+
+// Style of each token kind, the defaults suit dark and light terminals
+struct theme {
+    styleSet text;
+    styleSet key         = fg::blue;
+    styleSet string      = fg::green;
+    styleSet number      = fg::cyan;
+    styleSet keyword     = fg::magenta;
+    styleSet punctuation = styleSet();
+    styleSet comment     = style::dim;
+
+    const styleSet &of(const token kind) const noexcept
+    {
+        switch (kind) {
+            case token::key: return key;
+            case token::string: return string;
+            case token::number: return number;
+            case token::keyword: return keyword;
+            case token::punctuation: return punctuation;
+            case token::comment: return comment;
+            default: return text;
+        }
+    }
+};
+
+namespace rang_implementation {
+
+    constexpr std::size_t tokenKinds = 7;
+
+    enum charClass : unsigned char {
+        otherChar,
+        spaceChar,  // blanks and line breaks
+        wordChar,   // letters, '_', '$' and UTF-8 bytes
+        digitChar,
+        quoteChar,  // " and '
+        punctChar,
+        minusChar,
+        slashChar,
+        hashChar,
+        equalsChar
+    };
+
+    struct charClassTable {
+        unsigned char of[256];
+
+        charClassTable() noexcept
+        {
+            for (unsigned c = 0; c < 256; ++c) {
+                of[c] = c >= 0x80 || (c >= 'a' && c <= 'z')
+                    || (c >= 'A' && c <= 'Z') || c == '_' || c == '$'
+                  ? wordChar
+                  : otherChar;
+            }
+            for (const char *c = " \t\r\n\f\v"; *c != '\0'; ++c) {
+                of[static_cast<unsigned char>(*c)] = spaceChar;
+            }
+            for (unsigned c = '0'; c <= '9'; ++c) {
+                of[c] = digitChar;
+            }
+            for (const char *c = "{}[](),:;.<>+*%&|^!~?@"; *c != '\0'; ++c) {
+                of[static_cast<unsigned char>(*c)] = punctChar;
+            }
+            of[static_cast<unsigned char>('"')]  = quoteChar;
+            of[static_cast<unsigned char>('\'')] = quoteChar;
+            of[static_cast<unsigned char>('-')]  = minusChar;
+            of[static_cast<unsigned char>('/')]  = slashChar;
+            of[static_cast<unsigned char>('#')]  = hashChar;
+            of[static_cast<unsigned char>('=')]  = equalsChar;
+        }
+    };
+
+    inline const unsigned char *charClasses() noexcept
+    {
+        static const charClassTable table;
+        return table.of;
+    }
+
+    // Token scanners, each takes p < end and returns one past the token
+    struct scanner {
+        const unsigned char *classes;
+        const char *end;
+
+        unsigned char classOf(const char *p) const noexcept
+        {
+            return classes[static_cast<unsigned char>(*p)];
+        }
+
+        const char *skip(const char *p, const unsigned char cls) const
+          noexcept
+        {
+            while (p != end && classOf(p) == cls) {
+                ++p;
+            }
+            return p;
+        }
+
+        const char *word(const char *p) const noexcept
+        {
+            while (p != end
+                   && (classOf(p) == wordChar || classOf(p) == digitChar)) {
+                ++p;
+            }
+            return p;
+        }
+
+        // Past the closing quote, or the line break of an unclosed string
+        const char *quoted(const char *p, const bool oneLine) const noexcept
+        {
+            const char quote = *p++;
+            while (p != end && *p != quote) {
+                if (*p == '\\' && p + 1 != end) {
+                    ++p;
+                } else if (oneLine && *p == '\n') {
+                    return p;
+                }
+                ++p;
+            }
+            return p == end ? end : p + 1;
+        }
+
+        // Digits, letters and points, with signs after an exponent
+        const char *number(const char *p) const noexcept
+        {
+            if (*p == '-') {
+                ++p;
+            }
+            while (p != end) {
+                const unsigned char cls = classOf(p);
+                if (cls == digitChar || cls == wordChar || *p == '.') {
+                    ++p;
+                } else if ((*p == '+' || *p == '-')
+                           && (p[-1] == 'e' || p[-1] == 'E')) {
+                    ++p;
+                } else {
+                    break;
+                }
+            }
+            return p;
+        }
+
+        static std::size_t size(const char *p, const char *q) noexcept
+        {
+            return static_cast<std::size_t>(q - p);
+        }
+
+        bool nextIs(const char *p, const char c) const noexcept
+        {
+            p = skip(p, spaceChar);
+            return p != end && *p == c;
+        }
+    };
+
+    inline bool isLiteral(const char *p, const std::size_t size) noexcept
+    {
+        return (size == 4
+                && (std::memcmp(p, "true", 4) == 0
+                    || std::memcmp(p, "null", 4) == 0))
+          || (size == 5 && std::memcmp(p, "false", 5) == 0);
+    }
+
+    inline bool isCKeyword(const char *p, const std::size_t size) noexcept
+    {
+        static const char *const keywords[]
+          = { "auto",      "bool",      "break",     "case",      "catch",
+              "char",      "class",     "const",     "constexpr", "continue",
+              "default",   "delete",    "do",        "double",    "else",
+              "enum",      "explicit",  "extern",    "false",     "final",
+              "float",     "for",       "function",  "if",        "import",
+              "inline",    "int",       "let",       "long",      "namespace",
+              "new",       "noexcept",  "nullptr",   "null",      "operator",
+              "override",  "private",   "protected", "public",    "return",
+              "short",     "signed",    "sizeof",    "static",    "struct",
+              "switch",    "template",  "this",      "throw",     "true",
+              "try",       "typedef",   "typename",  "union",     "unsigned",
+              "using",     "var",       "virtual",   "void",      "volatile",
+              "while" };
+        if (size < 2 || size > 9) {
+            return false;
+        }
+        for (const char *keyword : keywords) {
+            if (keyword[0] == p[0] && std::strlen(keyword) == size
+                && std::memcmp(keyword, p, size) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Emit>
+    void tokenizeJson(const scanner &s, const char *p, Emit &emit)
+    {
+        while (p != s.end) {
+            const char *start = p;
+            token kind        = token::text;
+            switch (s.classOf(p)) {
+                case spaceChar: p = s.skip(p, spaceChar); break;
+                case quoteChar:
+                    p    = s.quoted(p, false);
+                    kind = s.nextIs(p, ':') ? token::key : token::string;
+                    break;
+                case digitChar:
+                case minusChar:
+                    p    = s.number(p);
+                    kind = token::number;
+                    break;
+                case wordChar:
+                    p    = s.word(p);
+                    kind = isLiteral(start, s.size(start, p))
+                      ? token::keyword
+                      : token::text;
+                    break;
+                case punctChar:
+                    p    = s.skip(p, punctChar);
+                    kind = token::punctuation;
+                    break;
+                default: ++p; break;
+            }
+            emit(kind, start, s.size(start, p));
+        }
+    }
+
+    template <typename Emit>
+    void tokenizeKeyValue(const scanner &s, const char *p, Emit &emit)
+    {
+        while (p != s.end) {
+            const char *start = p;
+            token kind        = token::text;
+            switch (s.classOf(p)) {
+                case spaceChar: p = s.skip(p, spaceChar); break;
+                case equalsChar:
+                    ++p;
+                    kind = token::punctuation;
+                    break;
+                case quoteChar:
+                    p    = s.quoted(p, true);
+                    kind = token::string;
+                    break;
+                default: {
+                    const bool digit = s.classOf(p) == digitChar
+                      || (*p == '-' && p + 1 != s.end
+                          && s.classOf(p + 1) == digitChar);
+                    while (p != s.end && s.classOf(p) != spaceChar
+                           && s.classOf(p) != equalsChar) {
+                        ++p;
+                    }
+                    if (p != s.end && *p == '=') {
+                        kind = token::key;
+                    } else if (digit) {
+                        kind = token::number;
+                    } else if (isLiteral(start, s.size(start, p))) {
+                        kind = token::keyword;
+                    }
+                    break;
+                }
+            }
+            emit(kind, start, s.size(start, p));
+        }
+    }
+
+    template <typename Emit>
+    void tokenizeCLike(const scanner &s, const char *p, Emit &emit)
+    {
+        bool lineStart = true;  // only blanks since the last line break
+        while (p != s.end) {
+            const char *start = p;
+            token kind        = token::text;
+            switch (s.classOf(p)) {
+                case spaceChar: p = s.skip(p, spaceChar); break;
+                case wordChar:
+                    p    = s.word(p);
+                    kind = isCKeyword(start, s.size(start, p))
+                      ? token::keyword
+                      : token::text;
+                    break;
+                case digitChar:
+                    p    = s.number(p);
+                    kind = token::number;
+                    break;
+                case quoteChar:
+                    p    = s.quoted(p, true);
+                    kind = token::string;
+                    break;
+                case hashChar:
+                    p    = lineStart ? s.word(p + 1) : p + 1;
+                    kind = lineStart ? token::keyword : token::punctuation;
+                    break;
+                case slashChar:
+                    if (p + 1 != s.end && p[1] == '/') {
+                        while (p != s.end && *p != '\n') {
+                            ++p;
+                        }
+                        kind = token::comment;
+                        break;
+                    }
+                    if (p + 1 != s.end && p[1] == '*') {
+                        p += 2;
+                        while (p != s.end
+                               && !(*p == '*' && p + 1 != s.end
+                                    && p[1] == '/')) {
+                            ++p;
+                        }
+                        p    = p == s.end ? p : p + 2;
+                        kind = token::comment;
+                        break;
+                    }
+                    ++p;
+                    kind = token::punctuation;
+                    break;
+                case punctChar:
+                case minusChar:
+                case equalsChar:
+                    ++p;
+                    while (p != s.end
+                           && (s.classOf(p) == punctChar
+                               || s.classOf(p) == minusChar
+                               || s.classOf(p) == equalsChar)) {
+                        ++p;
+                    }
+                    kind = token::punctuation;
+                    break;
+                default: ++p; break;
+            }
+            if (s.classOf(start) == spaceChar) {
+                lineStart = lineStart
+                  || std::memchr(start, '\n', s.size(start, p)) != nullptr;
+            } else {
+                lineStart = false;
+            }
+            emit(kind, start, s.size(start, p));
+        }
+    }
+
+    /* Gathers output in a fixed buffer and writes it to the stream in
+     * large pieces; pieces bigger than the buffer go straight through.
+     */
+    class highlightSink {
+    public:
+        explicit highlightSink(std::ostream &os) : os_(os), used_(0) {}
+
+        highlightSink(const highlightSink &) = delete;
+        highlightSink &operator=(const highlightSink &) = delete;
+
+        ~highlightSink() { flush(); }
+
+        void write(const char *data, const std::size_t size)
+        {
+            if (size > sizeof buf_ - used_) {
+                flush();
+                if (size > sizeof buf_) {
+                    os_.write(data, static_cast<std::streamsize>(size));
+                    return;
+                }
+            }
+            std::memcpy(buf_ + used_, data, size);
+            used_ += size;
+        }
+
+        void flush()
+        {
+            if (used_ != 0) {
+                os_.write(buf_, static_cast<std::streamsize>(used_));
+                used_ = 0;
+            }
+        }
+
+    private:
+        std::ostream &os_;
+        std::size_t used_;
+        char buf_[8192];
+    };
+
+}  // namespace rang_implementation
+
+/* Splits text into tokens of the given syntax in one pass, calling
+ * emit(token kind, const char *data, std::size_t size) for each. The
+ * tokens cover all of text in order. Characters are classified with a
+ * 256 entry table; input that doesn't follow the syntax still gets
+ * tokens, mostly text.
+ */
+template <typename Emit>
+inline void tokenize(const syntax lang, const char *text,
+                     const std::size_t size, Emit &&emit)
+{
+    namespace impl = rang_implementation;
+    const impl::scanner s{ impl::charClasses(), text + size };
+    switch (lang) {
+        case syntax::json: impl::tokenizeJson(s, text, emit); break;
+        case syntax::keyValue: impl::tokenizeKeyValue(s, text, emit); break;
+        default: impl::tokenizeCLike(s, text, emit); break;
+    }
+}
+
+/* Writes text to os with its tokens in the styles of colors:
+ *
+ *   rang::highlight(std::cout, rang::syntax::json, payload.data(),
+ *                   payload.size());
+ *
+ * Colors follow the same decision as operator<<; without them text is
+ * written as it is, not tokenized. Escapes are only written where the
+ * style changes, and everything goes out through an 8 KiB buffer.
+ */
+inline void highlight(std::ostream &os, const syntax lang, const char *text,
+                      const std::size_t size, const theme &colors = theme())
+{
+    namespace impl = rang_implementation;
+    if (!impl::shouldColorize(os) || !impl::writesAnsi(os)) {
+        os.write(text, static_cast<std::streamsize>(size));
+        return;
+    }
+    // Kinds with the same escape share the first one's, so runs of them
+    // get one escape
+    escape escapes[impl::tokenKinds];
+    const escape *of[impl::tokenKinds];
+    for (std::size_t i = 0; i < impl::tokenKinds; ++i) {
+        escapes[i] = escape(colors.of(static_cast<token>(i)));
+        of[i]      = escapes[i].empty() ? nullptr : &escapes[i];
+        for (std::size_t j = 0; j < i && of[i] != nullptr; ++j) {
+            if (of[j] != nullptr && of[j]->size() == of[i]->size()
+                && std::memcmp(of[j]->data(), of[i]->data(), of[i]->size())
+                  == 0) {
+                of[i] = of[j];
+            }
+        }
+    }
+    // Tokens are adjacent in text, so the text since the last escape is
+    // copied in one piece when the style changes
+    impl::highlightSink sink(os);
+    const escape *shown = nullptr;  // style the output is in
+    const char *run     = text;
+    tokenize(lang, text, size,
+             [&](const token kind, const char *data, const std::size_t) {
+                 const escape *next = of[static_cast<std::size_t>(kind)];
+                 if (next == shown) {
+                     return;
+                 }
+                 sink.write(run, static_cast<std::size_t>(data - run));
+                 if (shown != nullptr) {
+                     sink.write("\033[0m", 4);
+                 }
+                 if (next != nullptr) {
+                     sink.write(next->data(), next->size());
+                 }
+                 shown = next;
+                 run   = data;
+             });
+    sink.write(run, static_cast<std::size_t>(text + size - run));
+    if (shown != nullptr) {
+        sink.write("\033[0m", 4);
+    }
+}
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+// emit(token kind, std::string_view text)
+template <typename Emit>
+inline void tokenize(const syntax lang, const std::string_view text,
+                     Emit &&emit)
+{
+    tokenize(lang, text.data(), text.size(),
+             [&emit](const token kind, const char *data,
+                     const std::size_t size) {
+                 emit(kind, std::string_view(data, size));
+             });
+}
+
+inline void highlight(std::ostream &os, const syntax lang,
+                      const std::string_view text,
+                      const theme &colors = theme())
+{
+    highlight(os, lang, text.data(), text.size(), colors);
+}
+#endif
+
+}  // namespace rang
+
+#endif /* ifndef RANG_HIGHLIGHT_DOT_HPP */
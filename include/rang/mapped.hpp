@@ -0,0 +1,141 @@
+#ifndef RANG_MAPPED_DOT_HPP
+#define RANG_MAPPED_DOT_HPP
+
+#include "fwd.hpp"
+
+#include <cstddef>
+
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(RANG_OS_WIN)
+// Guarded like in core-inl.hpp, so no min and max macros leak to users
+#ifndef NOMINMAX
+#define NOMINMAX
+#define RANG_UNDEF_NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define RANG_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifdef RANG_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef RANG_UNDEF_NOMINMAX
+#endif
+#ifdef RANG_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef RANG_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#endif
+
+namespace rang {
+
+/* A file mapped read only, for handing inputs of hundreds of MB to diff or
+ * highlight without reading them into memory first:
+ *
+ *   rang::mappedFile file("big.log");
+ *   if (file.valid()) {
+ *       rang::highlight(std::cout, rang::syntax::keyValue, file.data(),
+ *                       file.size());
+ *   }
+ *
+ * Empty files are valid with a null data(). The pages stay mapped until
+ * the object is destroyed.
+ */
+class mappedFile {
+public:
+    explicit mappedFile(const char *path) noexcept
+        : data_(nullptr), size_(0), valid_(false)
+    {
+        map(path);
+    }
+
+    mappedFile(const mappedFile &) = delete;
+    mappedFile &operator=(const mappedFile &) = delete;
+
+    ~mappedFile()
+    {
+        if (data_ == nullptr) {
+            return;
+        }
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+        munmap(const_cast<char *>(data_), size_);
+#elif defined(RANG_OS_WIN)
+        UnmapViewOfFile(data_);
+#endif
+    }
+
+    bool valid() const noexcept { return valid_; }
+    const char *data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+
+private:
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+    void map(const char *path) noexcept
+    {
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            size_ = static_cast<std::size_t>(info.st_size);
+            if (size_ == 0) {
+                valid_ = true;
+            } else {
+                void *at = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (at != MAP_FAILED) {
+                    // Diffs and colorizers read front to back
+                    madvise(at, size_, MADV_SEQUENTIAL);
+                    data_  = static_cast<const char *>(at);
+                    valid_ = true;
+                } else {
+                    size_ = 0;
+                }
+            }
+        }
+        close(fd);
+    }
+#elif defined(RANG_OS_WIN)
+    void map(const char *path) noexcept
+    {
+        const HANDLE file
+          = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize)
+            && static_cast<unsigned long long>(fileSize.QuadPart)
+              <= static_cast<std::size_t>(-1)) {
+            size_ = static_cast<std::size_t>(fileSize.QuadPart);
+            if (size_ == 0) {
+                valid_ = true;
+            } else {
+                const HANDLE mapping = CreateFileMappingA(
+                  file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping != nullptr) {
+                    data_ = static_cast<const char *>(
+                      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                    CloseHandle(mapping);
+                }
+                valid_ = data_ != nullptr;
+                size_  = valid_ ? size_ : 0;
+            }
+        }
+        CloseHandle(file);
+    }
+#endif
+
+    const char *data_;
+    std::size_t size_;
+    bool valid_;
+};
+
+}  // namespace rang
+
+#endif /* ifndef RANG_MAPPED_DOT_HPP */
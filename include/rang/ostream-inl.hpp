@@ -0,0 +1,142 @@
+#ifndef RANG_OSTREAM_INL_DOT_HPP
+#define RANG_OSTREAM_INL_DOT_HPP
+
+// Terminal detection for streams of rang/ostream.hpp, inline in header-only
+// mode and built once from src/rang.cpp with RANG_COMPILED
+
+#include "core-inl.hpp"
+#include "ostream.hpp"
+
+#include <iostream>
+#include <mutex>
+
+#if defined(__GLIBCXX__)                                                       \
+  && (defined(__GXX_RTTI) || defined(_CPPRTTI) || defined(__cpp_rtti))
+#define RANG_FILEBUF_FD
+#include <ext/stdio_sync_filebuf.h>
+#include <fstream>
+#endif
+
+namespace rang {
+namespace rang_implementation {
+
+#ifdef RANG_FILEBUF_FD
+    // std::filebuf keeps its file in a protected member, reachable from a
+    // derived class through a pointer to member
+    struct filebufAccess : std::filebuf {
+        static int fd(const std::filebuf &buf) noexcept
+        {
+            return (const_cast<std::filebuf &>(buf).*(&filebufAccess::_M_file))
+              .fd();
+        }
+    };
+#endif
+
+    RANG_INLINE int bufferFd(const std::streambuf *osbuf) noexcept
+    {
+#ifdef RANG_FILEBUF_FD
+        if (const std::filebuf *buf
+            = dynamic_cast<const std::filebuf *>(osbuf)) {
+            return filebufAccess::fd(*buf);
+        }
+        using syncBuf = __gnu_cxx::stdio_sync_filebuf<char>;
+        if (const syncBuf *buf = dynamic_cast<const syncBuf *>(osbuf)) {
+            std::FILE *file = const_cast<syncBuf *>(buf)->file();
+            return file != nullptr ? fileno(file) : -1;
+        }
+#else
+        (void)osbuf;
+#endif
+        return -1;
+    }
+
+    RANG_INLINE bool isTerminal(const std::streambuf *osbuf) noexcept
+    {
+        osbuf = outputBuf(osbuf);
+        if (osbuf == nullptr) {
+            return false;
+        }
+        if (const int state = findTerminal(osbuf)) {
+            return (state & terminalBit) != 0;
+        }
+        if (osbuf == std::cout.rdbuf()) {
+            return isStdTerminal(1);
+        } else if (osbuf == std::cerr.rdbuf() || osbuf == std::clog.rdbuf()) {
+            return isStdTerminal(2);
+        }
+        // Not cached here: the fd of a filebuf changes when it is reopened,
+        // streams keep the decision made from it anyway
+        const int fd = bufferFd(osbuf);
+        return fd >= 0 && isTerminalFd(fd);
+    }
+
+    // Lines written to the same streambuf share one of these locks
+    inline std::mutex &lineLock(const std::streambuf *buf) noexcept
+    {
+        static std::mutex locks[16];
+        const std::uintptr_t key = reinterpret_cast<std::uintptr_t>(buf);
+        return locks[((key >> 4) ^ (key >> 12)) % 16];
+    }
+
+    RANG_INLINE void writeLine(std::ostream &os, const char *data,
+                               const std::streamsize size)
+    {
+        std::lock_guard<std::mutex> lock(lineLock(os.rdbuf()));
+        if (shouldColorize(os) && writesAnsi(os)) {
+            os.write(data, size);
+            return;
+        }
+        if (std::streambuf *target = os.rdbuf()) {
+            rang::stripbuf plain(target, control::Off);
+            if (plain.sputn(data, size) != size) {
+                os.setstate(std::ios::badbit);
+            } else if ((os.flags() & std::ios::unitbuf) != 0) {
+                os.flush();
+            }
+        }
+    }
+
+#ifdef RANG_OS_WIN
+    inline HANDLE getConsoleHandle(const std::streambuf *osbuf) noexcept
+    {
+        osbuf = outputBuf(osbuf);
+        if (osbuf == std::cout.rdbuf()) {
+            static const HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
+            return hStdout;
+        } else if (osbuf == std::cerr.rdbuf() || osbuf == std::clog.rdbuf()) {
+            static const HANDLE hStderr = GetStdHandle(STD_ERROR_HANDLE);
+            return hStderr;
+        }
+        return INVALID_HANDLE_VALUE;
+    }
+
+    RANG_INLINE bool supportsAnsi(const std::streambuf *osbuf) noexcept
+    {
+        osbuf = outputBuf(osbuf);
+        if (osbuf == std::cout.rdbuf()) {
+            return autoAnsi(_fileno(stdout));
+        } else if (osbuf == std::cerr.rdbuf() || osbuf == std::clog.rdbuf()) {
+            return autoAnsi(_fileno(stderr));
+        }
+        return false;
+    }
+
+    RANG_INLINE void setWinColorNative(std::ostream &os,
+                                       const unsigned char *codes,
+                                       const std::size_t count)
+    {
+        const HANDLE h = getConsoleHandle(os.rdbuf());
+        if (h != INVALID_HANDLE_VALUE) {
+            // Out all buffered text to console with previous settings:
+            os.flush();
+            setConsoleCodes(h, codes, count);
+        }
+    }
+#endif
+
+}  // namespace rang_implementation
+}  // namespace rang
+
+#undef RANG_FILEBUF_FD
+
+#endif /* ifndef RANG_OSTREAM_INL_DOT_HPP */
@@ -0,0 +1,1447 @@
+#ifndef RANG_OSTREAM_DOT_HPP
+#define RANG_OSTREAM_DOT_HPP
+
+/* rang for iostreams: operator<< for the attributes, colorbuf, stripbuf,
+ * per-stream modes, rang::line and markup. Only <ostream> is needed here;
+ * telling cout, cerr and clog apart takes <iostream>, which header-only
+ * mode includes with rang/ostream-inl.hpp and RANG_COMPILED keeps in the
+ * library.
+ */
+
+#include "core.hpp"
+
+#include <ios>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <tuple>
+#include <vector>
+
+namespace rang {
+
+namespace rang_implementation {
+
+    template <typename T>
+    struct isAnsiSeq : std::false_type {
+    };
+
+    template <int... Codes>
+    struct isAnsiSeq<rang::ansiSeq<Codes...>> : std::true_type {
+    };
+
+    // Codes covered by each attribute enum, first code and table length
+    template <typename T>
+    struct sgrRange;
+
+    template <>
+    struct sgrRange<rang::style> {
+        static constexpr int first = 0;
+        static constexpr int count = 10;
+    };
+
+    template <>
+    struct sgrRange<rang::fg> {
+        static constexpr int first = 30;
+        static constexpr int count = 10;
+    };
+
+    template <>
+    struct sgrRange<rang::bg> {
+        static constexpr int first = 40;
+        static constexpr int count = 10;
+    };
+
+    template <>
+    struct sgrRange<rang::fgB> {
+        static constexpr int first = 90;
+        static constexpr int count = 8;
+    };
+
+    template <>
+    struct sgrRange<rang::bgB> {
+        static constexpr int first = 100;
+        static constexpr int count = 8;
+    };
+
+    // Precomputed escape sequences for every code of an enum
+    template <int First, typename Indexes>
+    struct sgrTable;
+
+    template <int First, std::size_t... Is>
+    struct sgrTable<First, indexSeq<Is...>> {
+        static constexpr const char *data[sizeof...(Is)]
+          = { rang::ansiSeq<First + static_cast<int>(Is)>::value... };
+        static constexpr unsigned char size[sizeof...(Is)]
+          = { rang::ansiSeq<First + static_cast<int>(Is)>::size... };
+    };
+
+    template <int First, std::size_t... Is>
+    constexpr const char *sgrTable<First, indexSeq<Is...>>::data[];
+
+    template <int First, std::size_t... Is>
+    constexpr unsigned char sgrTable<First, indexSeq<Is...>>::size[];
+
+    template <typename T>
+    inline typename std::enable_if<isSgrEnum<T>::value>::type
+    writeEscape(std::ostream &os, const T value)
+    {
+        using range = sgrRange<T>;
+        using table = sgrTable<range::first,
+                               typename makeIndexSeq<range::count>::type>;
+        const unsigned i
+          = static_cast<unsigned>(static_cast<int>(value) - range::first);
+        if (i < static_cast<unsigned>(range::count)) {
+            os.write(table::data[i], table::size[i]);
+        } else {
+            os << "\033[" << static_cast<int>(value) << "m";
+        }
+    }
+
+    template <typename T>
+    inline typename std::enable_if<isExtendedColor<T>::value>::type
+    writeEscape(std::ostream &os, const T &value)
+    {
+        sgrCodes codes = codesOf(value);
+        codes.count    = downsample(codes.data, codes.count,
+                                 colorLevelSetting(), codes.data);
+        const escapeBuf buf = encode(codes);
+        os.write(buf.data, static_cast<std::streamsize>(buf.size));
+    }
+
+    inline void writeEscape(std::ostream &os, const rang::styleSet &value)
+    {
+        const rang::colorLevel level = colorLevelSetting();
+        if (value.extended() && level != rang::colorLevel::TrueColor
+            && level != rang::colorLevel::None) {
+            unsigned char codes[rang::styleSet::maxCodes];
+            char seq[4 + 4 * rang::styleSet::maxCodes];
+            const std::size_t count
+              = downsample(value.codes(), value.count(), level, codes);
+            os.write(seq, writeSequence(seq, codes, count) - seq);
+            return;
+        }
+        os.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    template <int... Codes>
+    inline void writeEscape(std::ostream &os, const rang::ansiSeq<Codes...> &)
+    {
+        os.write(rang::ansiSeq<Codes...>::value,
+                 static_cast<std::streamsize>(rang::ansiSeq<Codes...>::size));
+    }
+
+}  // namespace rang_implementation
+
+/* Buffer in front of another streambuf, for unbuffered targets like the one
+ * of std::cerr where every escape and text fragment would otherwise become
+ * its own write:
+ *
+ *   rang::colorbuf buf(std::cerr.rdbuf());
+ *   std::ostream err(&buf);
+ *   err << rang::fg::red << "failed" << rang::style::reset << '\n';
+ *
+ * Text and escapes are collected and handed to the target in one call when
+ * a newline is written (unless lineBuffered is false), when the buffer is
+ * full and on flush. rang treats the stream as a terminal if the target is
+ * one.
+ */
+class colorbuf : public std::streambuf {
+public:
+    explicit colorbuf(std::streambuf *target, const std::size_t capacity = 4096,
+                      const bool lineBuffered = true)
+        : target_(target), buffer_(capacity), lineBuffered_(lineBuffered)
+    {
+        setPending(0);
+    }
+
+    colorbuf(const colorbuf &) = delete;
+    colorbuf &operator=(const colorbuf &) = delete;
+
+    ~colorbuf() override { flushBuffer(); }
+
+    std::streambuf *target() const noexcept { return target_; }
+
+protected:
+    int_type overflow(const int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return flushBuffer() ? traits_type::not_eof(ch)
+                                 : traits_type::eof();
+        }
+        const char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+    std::streamsize xsputn(const char *s, const std::streamsize n) override
+    {
+        const std::size_t size = static_cast<std::size_t>(n);
+        if (size == 0) {
+            return 0;
+        }
+        if (size > buffer_.size() - pending()) {
+            if (!flushBuffer()) {
+                return 0;
+            }
+            // Too large to be buffered, pass it on in one piece
+            if (size > buffer_.size()) {
+                return target_->sputn(s, n);
+            }
+        }
+        const std::size_t used = pending();
+        std::memcpy(&buffer_[used], s, size);
+        setPending(used + size);
+        if (lineBuffered_ && std::memchr(s, '\n', size) != nullptr) {
+            flushBuffer();
+        }
+        return n;
+    }
+
+    int sync() override
+    {
+        return flushBuffer() && target_->pubsync() != -1 ? 0 : -1;
+    }
+
+private:
+    std::size_t pending() const noexcept
+    {
+        return static_cast<std::size_t>(pptr() - pbase());
+    }
+
+    /* Pending output is always pbase()..pptr(). Line buffering leaves no
+     * room behind pptr(), so single characters reach overflow and newlines
+     * written with put() or operator<<(char) are seen too.
+     */
+    void setPending(const std::size_t used) noexcept
+    {
+        char *begin = buffer_.empty() ? nullptr : &buffer_[0];
+        setp(begin, begin + (lineBuffered_ ? used : buffer_.size()));
+        pbump(static_cast<int>(used));
+    }
+
+    bool flushBuffer()
+    {
+        const std::streamsize n = pptr() - pbase();
+        const bool ok           = n == 0 || target_->sputn(pbase(), n) == n;
+        setPending(0);
+        return ok;
+    }
+
+    std::streambuf *target_;
+    std::vector<char> buffer_;
+    bool lineBuffered_;
+};
+
+/* Filter in front of another streambuf that removes escape sequences from
+ * everything written through it, including text that already carries raw
+ * escapes from other libraries:
+ *
+ *   rang::stripbuf buf(std::cout.rdbuf());
+ *   std::ostream out(&buf);
+ *   out << libraryMessage;  // escapes only if stdout gets rang colors
+ *
+ * With control::Auto escapes are removed whenever rang would not color the
+ * target itself (see setControlMode), control::Off always removes them and
+ * control::Force passes everything through. CSI sequences like SGR and two
+ * byte escapes are removed, also when split across writes. Plain text is
+ * found with memchr and handed on in one piece.
+ */
+class stripbuf : public std::streambuf {
+public:
+    explicit stripbuf(std::streambuf *target,
+                      const control mode = control::Auto)
+        : target_(target), mode_(mode), state_(text), epoch_(0), strip_(false)
+    {
+    }
+
+    stripbuf(const stripbuf &) = delete;
+    stripbuf &operator=(const stripbuf &) = delete;
+
+    std::streambuf *target() const noexcept { return target_; }
+
+protected:
+    int_type overflow(const int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+        }
+        const char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+    std::streamsize xsputn(const char *s, const std::streamsize n) override
+    {
+        if (!stripping()) {
+            state_ = text;
+            return target_->sputn(s, n);
+        }
+        // Text between escapes is gathered into out and handed on in one
+        // piece, runs that don't fit go to the target directly
+        char out[512];
+        std::size_t used = 0;
+        parseState state = state_;
+        const char *end  = s + n;
+        for (const char *p = s; p != end;) {
+            if (state == text) {
+                const std::size_t left = static_cast<std::size_t>(end - p);
+                const void *esc        = std::memchr(p, '\033', left);
+                const char *stop
+                  = esc != nullptr ? static_cast<const char *>(esc) : end;
+                const std::size_t run = static_cast<std::size_t>(stop - p);
+                if (run > sizeof out - used) {
+                    if (!forward(out, used) || !forward(p, run)) {
+                        state_ = text;
+                        return 0;
+                    }
+                    used = 0;
+                } else {
+                    std::memcpy(out + used, p, run);
+                    used += run;
+                }
+                if (stop == end) {
+                    break;
+                }
+                state = escape;
+                p     = stop + 1;
+            } else if (state == escape) {
+                // ESC [ starts a CSI, anything else ends a two byte escape
+                state = *p++ == '[' ? csi : text;
+            } else {
+                // Parameters are 0x20..0x3F, the final byte 0x40..0x7E
+                while (p != end && (*p < 0x40 || *p > 0x7E)) {
+                    ++p;
+                }
+                if (p != end) {
+                    ++p;
+                    state = text;
+                }
+            }
+        }
+        state_ = state;
+        return forward(out, used) ? n : 0;
+    }
+
+    int sync() override { return target_->pubsync(); }
+
+private:
+    enum parseState { text, escape, csi };
+
+    bool stripping();
+
+    bool forward(const char *s, const std::size_t size)
+    {
+        const std::streamsize n = static_cast<std::streamsize>(size);
+        return n == 0 || target_->sputn(s, n) == n;
+    }
+
+    std::streambuf *target_;
+    control mode_;
+    parseState state_;
+    long epoch_;  // controlEpoch strip_ was decided for
+    bool strip_;
+};
+
+namespace rang_implementation {
+
+    /* Per-stream overrides set with setControlMode(os, ...) and
+     * setWinTermMode(os, ...), kept in the stream's iword: control + 1 in
+     * controlBits, winTerm + 1 in winTermBits, 0 where the global mode
+     * applies.
+     */
+    constexpr long controlBits = 0x0F;
+    constexpr long winTermBits = 0xF0;
+
+    inline int modeSlot()
+    {
+        static const int slot = std::ios_base::xalloc();
+        return slot;
+    }
+
+    inline winTerm streamWinTerm(std::ios_base &ios)
+    {
+        const long bits = (ios.iword(modeSlot()) & winTermBits) >> 4;
+        return bits != 0 ? static_cast<winTerm>(bits - 1)
+                         : winTermMode().load();
+    }
+
+    // The buffer that ends up writing the output, looking through colorbufs
+    // and stripbufs
+    inline const std::streambuf *outputBuf(const std::streambuf *osbuf) noexcept
+    {
+#if defined(__GXX_RTTI) || defined(_CPPRTTI) || defined(__cpp_rtti)
+        for (;;) {
+            if (const rang::colorbuf *buf
+                = dynamic_cast<const rang::colorbuf *>(osbuf)) {
+                osbuf = buf->target();
+            } else if (const rang::stripbuf *buf
+                       = dynamic_cast<const rang::stripbuf *>(osbuf)) {
+                osbuf = buf->target();
+            } else {
+                break;
+            }
+        }
+#endif
+        return osbuf;
+    }
+
+    // File descriptor a streambuf writes to if rang knows how to find it
+    // (libstdc++ filebufs, stdio_filebuf and stdio_sync_filebuf), else -1
+    RANG_INLINE int bufferFd(const std::streambuf *osbuf) noexcept;
+
+    /* Lock free table of the streambufs given to registerTerminal. A state
+     * is validBit | terminalBit, 0 for free entries and busyState while an
+     * entry is rewritten. Readers check the key again after loading the
+     * state, so they never see a state written for another streambuf.
+     */
+    struct terminalEntry {
+        std::atomic<const std::streambuf *> buf;
+        std::atomic<int> state;
+    };
+
+    constexpr int terminalBit = 1;
+    constexpr int validBit    = 2;
+    constexpr int busyState   = 4;
+
+    constexpr std::size_t terminalTableSize = 64;
+
+    inline terminalEntry *terminalTable() noexcept
+    {
+        static terminalEntry table[terminalTableSize];  // zero initialized
+        return table;
+    }
+
+    inline std::size_t terminalHash(const std::streambuf *buf) noexcept
+    {
+        const std::uintptr_t key = reinterpret_cast<std::uintptr_t>(buf);
+        return static_cast<std::size_t>((key >> 4) ^ (key >> 12));
+    }
+
+    // The state registered for buf, 0 if there is none
+    inline int findTerminal(const std::streambuf *buf) noexcept
+    {
+        terminalEntry *table   = terminalTable();
+        const std::size_t hash = terminalHash(buf);
+        for (std::size_t i = 0; i < terminalTableSize; ++i) {
+            terminalEntry &entry = table[(hash + i) % terminalTableSize];
+            const std::streambuf *key
+              = entry.buf.load(std::memory_order_acquire);
+            if (key == nullptr) {
+                break;  // keys are never removed, buf isn't further along
+            }
+            if (key != buf) {
+                continue;
+            }
+            const int state = entry.state.load(std::memory_order_acquire);
+            if ((state & validBit) != 0
+                && entry.buf.load(std::memory_order_acquire) == buf) {
+                return state;
+            }
+        }
+        return 0;
+    }
+
+    // Stores state in buf's entry or else a free one, false if none is left
+    inline bool storeTerminal(const std::streambuf *buf,
+                              const int state) noexcept
+    {
+        terminalEntry *table   = terminalTable();
+        const std::size_t hash = terminalHash(buf);
+        for (int pass = 0; pass < 2; ++pass) {
+            for (std::size_t i = 0; i < terminalTableSize; ++i) {
+                terminalEntry &entry = table[(hash + i) % terminalTableSize];
+                int current = entry.state.load(std::memory_order_acquire);
+                const bool usable = pass == 0
+                  ? (current & validBit) != 0 && entry.buf.load() == buf
+                  : current == 0;
+                if (!usable
+                    || !entry.state.compare_exchange_strong(current,
+                                                            busyState)) {
+                    continue;
+                }
+                entry.buf.store(buf, std::memory_order_release);
+                entry.state.store(state, std::memory_order_release);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline void eraseTerminal(const std::streambuf *buf) noexcept
+    {
+        terminalEntry *table   = terminalTable();
+        const std::size_t hash = terminalHash(buf);
+        for (std::size_t i = 0; i < terminalTableSize; ++i) {
+            terminalEntry &entry = table[(hash + i) % terminalTableSize];
+            int current = entry.state.load(std::memory_order_acquire);
+            if ((current & validBit) != 0 && entry.buf.load() == buf) {
+                entry.state.compare_exchange_strong(current, 0);
+            }
+        }
+    }
+
+    RANG_INLINE bool isTerminal(const std::streambuf *osbuf) noexcept;
+
+    inline bool decideColorize(const std::streambuf *osbuf,
+                               const control mode) noexcept
+    {
+        switch (mode) {
+            case control::Auto: return supportsColor() && isTerminal(osbuf);
+            case control::Force: return true;
+            default: return false;
+        }
+    }
+
+    inline int streamSlot()
+    {
+        static const int slot = std::ios_base::xalloc();
+        return slot;
+    }
+
+    // Bits of the cached decision, the epoch it was made in above them
+    constexpr long colorDecision   = 1;
+    constexpr long fixedDecision   = 2;  // doesn't depend on global state
+    constexpr long controlDecision = 4;  // cursor, erase and screen control
+    constexpr int decisionBits     = 3;
+
+    inline long refreshDecision(std::ios &ios)
+    {
+        const int slot       = streamSlot();
+        const long epoch     = controlEpoch().load(std::memory_order_acquire);
+        const long overrides = ios.iword(modeSlot()) & controlBits;
+        const control mode   = overrides != 0
+          ? static_cast<control>(overrides - 1)
+          : controlMode().load();
+        // Control sequences only need a terminal, colors also a color level
+        const bool controls = mode == control::Force
+          || (mode == control::Auto && isTerminal(ios.rdbuf()));
+        const bool colorize
+          = controls && (mode == control::Force || supportsColor());
+        const bool fixed    = overrides != 0 && mode != control::Auto;
+        const long decision = (epoch << decisionBits)
+          | (fixed ? fixedDecision : 0) | (colorize ? colorDecision : 0)
+          | (controls ? controlDecision : 0);
+        ios.iword(slot) = decision;
+        ios.pword(slot) = ios.rdbuf();
+        return decision;
+    }
+
+    /* The decision for os, cached in the stream itself (iword holds epoch
+     * and result, pword the rdbuf it was made for), so the steady state
+     * skips isTerminal and the control mode lookup. The cache is only
+     * written on a miss: after setControlMode or when the stream is given
+     * another rdbuf. Streams with an Off or Force override don't read any
+     * global state at all.
+     */
+    inline long streamDecision(std::ios &ios)
+    {
+        const int slot    = streamSlot();
+        const long cached = ios.iword(slot);
+        if (ios.pword(slot) == ios.rdbuf()) {
+            if ((cached & fixedDecision) != 0
+                || (cached >> decisionBits)
+                  == controlEpoch().load(std::memory_order_acquire)) {
+                return cached;
+            }
+        }
+        return refreshDecision(ios);
+    }
+
+    // Whether rang colors should be written to os
+    inline bool shouldColorize(std::ios &ios)
+    {
+        return (streamDecision(ios) & colorDecision) != 0;
+    }
+
+    // Whether cursor, erase and screen control should be written to os
+    inline bool shouldControl(std::ios &ios)
+    {
+        return (streamDecision(ios) & controlDecision) != 0;
+    }
+
+    // Replaces the override bits in mask and drops the cached decision
+    inline void setStreamModes(std::ios_base &ios, const long mask,
+                               const long bits)
+    {
+        long &modes             = ios.iword(modeSlot());
+        modes                   = (modes & ~mask) | (bits & mask);
+        ios.iword(streamSlot()) = 0;
+    }
+
+    /* Attributes a stream's terminal currently shows, for streams with
+     * setStateTracking enabled. Colors are 0 for the default or
+     * kind << 24 | value, kind 1 being a basic SGR code, 2 a palette index
+     * and 3 a 0xRRGGBB color.
+     */
+    struct sgrState {
+        std::uint16_t styles;  // bit n is set while style code n is on
+        std::uint32_t fg;
+        std::uint32_t bg;
+        bool known;  // false after codes the tracker doesn't understand
+
+        sgrState() noexcept : styles(0), fg(0), bg(0), known(true) {}
+
+        void apply(const unsigned char *codes, const std::size_t count) noexcept
+        {
+            for (std::size_t i = 0; i < count;) {
+                const std::size_t length = groupLength(codes + i, count - i);
+                const unsigned code      = codes[i];
+                if (length == 3 || length == 5) {
+                    const std::uint32_t color = length == 3
+                      ? (2u << 24) | codes[i + 2]
+                      : (3u << 24) | (std::uint32_t(codes[i + 2]) << 16)
+                        | (std::uint32_t(codes[i + 3]) << 8) | codes[i + 4];
+                    (code == 38 ? fg : bg) = color;
+                } else if (code == 0) {
+                    *this = sgrState();
+                } else if (code < 10) {
+                    styles = static_cast<std::uint16_t>(styles | (1u << code));
+                } else if ((code >= 30 && code <= 37)
+                           || (code >= 90 && code <= 97)) {
+                    fg = (1u << 24) | code;
+                } else if ((code >= 40 && code <= 47)
+                           || (code >= 100 && code <= 107)) {
+                    bg = (1u << 24) | code;
+                } else if (code == 39) {
+                    fg = 0;
+                } else if (code == 49) {
+                    bg = 0;
+                } else {
+                    known = false;
+                }
+                i += length;
+            }
+        }
+    };
+
+    inline std::size_t appendColor(unsigned char *out, const unsigned selector,
+                                   const std::uint32_t color) noexcept
+    {
+        const unsigned kind = color >> 24;
+        if (kind == 0) {
+            out[0] = static_cast<unsigned char>(selector + 1);
+            return 1;
+        }
+        if (kind == 1) {
+            out[0] = static_cast<unsigned char>(color);
+            return 1;
+        }
+        out[0] = static_cast<unsigned char>(selector);
+        if (kind == 2) {
+            out[1] = 5;
+            out[2] = static_cast<unsigned char>(color);
+            return 3;
+        }
+        out[1] = 2;
+        out[2] = static_cast<unsigned char>(color >> 16);
+        out[3] = static_cast<unsigned char>(color >> 8);
+        out[4] = static_cast<unsigned char>(color);
+        return 5;
+    }
+
+    // Reset, nine styles and two 24-bit colors
+    constexpr std::size_t maxTransitionCodes = 1 + 9 + 5 + 5;
+
+    // Fewest codes that take the terminal from current to target
+    inline std::size_t transition(const sgrState &current,
+                                  const sgrState &target,
+                                  unsigned char *out) noexcept
+    {
+        std::size_t n = 0;
+        sgrState base = current;
+        if (!current.known || (current.styles & ~target.styles) != 0) {
+            out[n++] = 0;
+            base     = sgrState();
+        }
+        for (unsigned code = 1; code < 10; ++code) {
+            if ((target.styles & ~base.styles) & (1u << code)) {
+                out[n++] = static_cast<unsigned char>(code);
+            }
+        }
+        if (target.fg != base.fg) {
+            n += appendColor(out + n, 38, target.fg);
+        }
+        if (target.bg != base.bg) {
+            n += appendColor(out + n, 48, target.bg);
+        }
+        return n;
+    }
+
+    inline int trackerSlot()
+    {
+        static const int slot = std::ios_base::xalloc();
+        return slot;
+    }
+
+    inline sgrState *trackedState(std::ios_base &ios)
+    {
+        return static_cast<sgrState *>(ios.pword(trackerSlot()));
+    }
+
+    inline void trackerEvent(const std::ios_base::event ev, std::ios_base &ios,
+                             const int slot)
+    {
+        void *&state = ios.pword(slot);
+        if (ev == std::ios_base::erase_event) {
+            delete static_cast<sgrState *>(state);
+            state = nullptr;
+        } else if (ev == std::ios_base::copyfmt_event && state != nullptr) {
+            // copyfmt copied the pointer, the copy needs its own state
+            const sgrState *source = static_cast<sgrState *>(state);
+            state                  = new (std::nothrow) sgrState(*source);
+        }
+    }
+
+    // Writes only what changes the tracked state, merged into one sequence
+    inline void writeTracked(std::ostream &os, sgrState &state,
+                             const unsigned char *codes,
+                             const std::size_t count)
+    {
+        sgrState target = state;
+        target.apply(codes, count);
+        if (!target.known) {
+            char seq[4 + 4 * rang::styleSet::maxCodes];
+            os.write(seq, writeSequence(seq, codes, count) - seq);
+            state = target;
+            return;
+        }
+
+        unsigned char changes[maxTransitionCodes];
+        std::size_t n = transition(state, target, changes);
+        state         = target;
+        if (n != 0) {
+            n = downsample(changes, n, colorLevelSetting(), changes);
+            char seq[4 + 4 * maxTransitionCodes];
+            os.write(seq, writeSequence(seq, changes, n) - seq);
+        }
+    }
+
+    template <typename T>
+    inline typename std::enable_if<isSgrEnum<T>::value>::type
+    writeTracked(std::ostream &os, sgrState &state, const T value)
+    {
+        const unsigned char code = static_cast<unsigned char>(value);
+        writeTracked(os, state, &code, 1);
+    }
+
+    template <typename T>
+    inline typename std::enable_if<isExtendedColor<T>::value>::type
+    writeTracked(std::ostream &os, sgrState &state, const T &value)
+    {
+        const sgrCodes codes = codesOf(value);
+        writeTracked(os, state, codes.data, codes.count);
+    }
+
+    inline void writeTracked(std::ostream &os, sgrState &state,
+                             const rang::styleSet &value)
+    {
+        writeTracked(os, state, value.codes(), value.count());
+    }
+
+    template <int... Codes>
+    inline void writeTracked(std::ostream &os, sgrState &state,
+                             const rang::ansiSeq<Codes...> &)
+    {
+        writeTracked(os, state, rang::ansiSeq<Codes...>::codes,
+                     sizeof...(Codes));
+    }
+
+    // Escape for value, reduced to the changes if os tracks its state
+    template <typename T>
+    inline void writeAnsi(std::ostream &os, const T &value)
+    {
+        if (sgrState *state = trackedState(os)) {
+            writeTracked(os, *state, value);
+        } else {
+            writeEscape(os, value);
+        }
+    }
+
+    template <typename T>
+    using enableStd = typename std::enable_if<
+      isSgrEnum<T>::value || isExtendedColor<T>::value
+        || std::is_same<T, rang::styleSet>::value || isAnsiSeq<T>::value,
+      std::ostream &>::type;
+
+#ifdef RANG_OS_WIN
+    RANG_INLINE bool supportsAnsi(const std::streambuf *osbuf) noexcept;
+
+    template <typename T>
+    inline void setWinColorAnsi(std::ostream &os, T const &value)
+    {
+        writeAnsi(os, value);
+    }
+
+    // Console attributes for codes, set after flushing what os buffered
+    RANG_INLINE void setWinColorNative(std::ostream &os,
+                                       const unsigned char *codes,
+                                       std::size_t count);
+
+    template <typename T>
+    inline void setWinColorNative(std::ostream &os, T const &value)
+    {
+        const rang::styleSet set(value);
+        setWinColorNative(os, set.codes(), set.count());
+    }
+
+    template <int... Codes>
+    inline void setWinColorNative(std::ostream &os,
+                                  const rang::ansiSeq<Codes...> &)
+    {
+        setWinColorNative(os, rang::ansiSeq<Codes...>::codes,
+                          sizeof...(Codes));
+    }
+
+    template <typename T>
+    inline enableStd<T> setColor(std::ostream &os, T const &value)
+    {
+        const winTerm mode = streamWinTerm(os);
+        if (mode == winTerm::Auto) {
+            if (supportsAnsi(os.rdbuf())) {
+                setWinColorAnsi(os, value);
+            } else {
+                setWinColorNative(os, value);
+            }
+        } else if (mode == winTerm::Ansi) {
+            setWinColorAnsi(os, value);
+        } else {
+            setWinColorNative(os, value);
+        }
+        return os;
+    }
+
+    // Whether colors reach os as escape sequences, not console API calls
+    inline bool writesAnsi(std::ostream &os)
+    {
+        const winTerm mode = streamWinTerm(os);
+        return mode == winTerm::Ansi
+          || (mode == winTerm::Auto && supportsAnsi(os.rdbuf()));
+    }
+#else
+    template <typename T>
+    inline enableStd<T> setColor(std::ostream &os, T const &value)
+    {
+        writeAnsi(os, value);
+        return os;
+    }
+
+    inline bool writesAnsi(std::ostream &) { return true; }
+#endif
+
+    // Growable put area that keeps its memory between lines
+    class lineBuf : public std::streambuf {
+    public:
+        const char *data() const noexcept { return pbase(); }
+
+        std::size_t size() const noexcept
+        {
+            return static_cast<std::size_t>(pptr() - pbase());
+        }
+
+        void clear() noexcept
+        {
+            char *begin = buffer_.empty() ? nullptr : &buffer_[0];
+            setp(begin, begin + buffer_.size());
+        }
+
+    protected:
+        int_type overflow(const int_type ch) override
+        {
+            if (traits_type::eq_int_type(ch, traits_type::eof())) {
+                return traits_type::not_eof(ch);
+            }
+            const char c = traits_type::to_char_type(ch);
+            return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+        }
+
+        std::streamsize xsputn(const char *s, const std::streamsize n) override
+        {
+            const std::size_t count = static_cast<std::size_t>(n);
+            const std::size_t used  = size();
+            if (count > static_cast<std::size_t>(epptr() - pptr())) {
+                const std::size_t least   = used + count > 256 ? used + count
+                                                               : 256;
+                const std::size_t doubled = buffer_.size() * 2;
+                buffer_.resize(doubled > least ? doubled : least);
+                clear();
+                pbump(static_cast<int>(used));
+            }
+            std::memcpy(pptr(), s, count);
+            pbump(static_cast<int>(count));
+            return n;
+        }
+
+    private:
+        std::vector<char> buffer_;
+    };
+
+    // A line under construction, always written with escapes
+    struct lineStorage {
+        lineBuf buf;
+        std::ostream os;
+        bool inUse;
+
+        lineStorage() : os(&buf), inUse(false)
+        {
+            setStreamModes(os, controlBits,
+                           static_cast<long>(control::Force) + 1);
+            setStreamModes(os, winTermBits,
+                           (static_cast<long>(winTerm::Ansi) + 1) << 4);
+        }
+    };
+
+    inline lineStorage &threadLineStorage()
+    {
+        static thread_local lineStorage storage;
+        return storage;
+    }
+
+    /* Writes a finished line to os in one call, under a lock shared by the
+     * lines going to the same streambuf, without its escapes unless os
+     * gets them.
+     */
+    RANG_INLINE void writeLine(std::ostream &os, const char *data,
+                               std::streamsize size);
+}  // namespace rang_implementation
+
+inline bool stripbuf::stripping()
+{
+    switch (mode_) {
+        case control::Off: return true;
+        case control::Force: return false;
+        default: break;
+    }
+    const long epoch
+      = rang_implementation::controlEpoch().load(std::memory_order_acquire);
+    if (epoch != epoch_) {
+        strip_ = !rang_implementation::decideColorize(
+          target_, rang_implementation::controlMode().load());
+        epoch_ = epoch;
+    }
+    return strip_;
+}
+
+template <typename T>
+inline rang_implementation::enableStd<T> operator<<(std::ostream &os,
+                                                    const T &value)
+{
+    return rang_implementation::shouldColorize(os)
+      ? rang_implementation::setColor(os, value)
+      : os;
+}
+
+/* Cursor, erase and screen control for os, under the same control mode as
+ * colors but whatever the color level. Consoles driven through the Windows
+ * console API get nothing.
+ */
+template <typename T>
+inline typename std::enable_if<rang_implementation::isControl<T>::value,
+                               std::ostream &>::type
+operator<<(std::ostream &os, const T &value)
+{
+    if (rang_implementation::shouldControl(os)
+        && rang_implementation::writesAnsi(os)) {
+        char seq[rang_implementation::maxControlSize];
+        os.write(seq, static_cast<std::streamsize>(
+                        rang_implementation::encodeControl(seq, value)));
+    }
+    return os;
+}
+
+// Windows terminal mode for os only, takes precedence over the global one
+inline void setWinTermMode(std::ostream &os, const rang::winTerm value)
+{
+    rang_implementation::setStreamModes(
+      os, rang_implementation::winTermBits,
+      (static_cast<long>(value) + 1) << 4);
+}
+
+/* Opt-in per stream: remember the attributes written to os and skip what
+ * wouldn't change them. Repeated colors and resets of the default state
+ * write nothing, and a styleSet only writes the codes that differ, merged
+ * into one sequence. rang assumes the terminal starts in its default state
+ * and that nothing else writes escapes to the stream; enabling again
+ * forgets what was tracked so far.
+ */
+inline void setStateTracking(std::ostream &os, const bool enable)
+{
+    using rang_implementation::sgrState;
+    const int slot = rang_implementation::trackerSlot();
+    long &hooked   = os.iword(slot);
+    void *&state   = os.pword(slot);
+    if (hooked == 0 && enable) {
+        os.register_callback(rang_implementation::trackerEvent, slot);
+        hooked = 1;
+    }
+    delete static_cast<sgrState *>(state);
+    state = enable ? new sgrState() : nullptr;
+}
+
+/* Lets control::Auto color the streams writing to buf when fd is a
+ * terminal, for streambufs rang can't find the fd of itself (libstdc++
+ * filebufs are looked up automatically). isatty is called once here and the
+ * result kept until unregisterTerminal(buf), which must be called before
+ * buf is destroyed. Returns false if the registry (64 entries) is full.
+ */
+inline bool registerTerminal(const std::streambuf *buf, const int fd) noexcept
+{
+    using namespace rang_implementation;
+    const bool stored = storeTerminal(
+      buf, validBit | (fd >= 0 && isTerminalFd(fd) ? terminalBit : 0));
+    controlEpoch().fetch_add(1, std::memory_order_release);
+    return stored;
+}
+
+inline void unregisterTerminal(const std::streambuf *buf) noexcept
+{
+    rang_implementation::eraseTerminal(buf);
+    rang_implementation::controlEpoch().fetch_add(1,
+                                                  std::memory_order_release);
+}
+
+/* Control mode for os only, takes precedence over the global one until
+ * clearStreamModes(os). A library can force colors into its own log file
+ * without turning them on for everyone else's streams.
+ */
+inline void setControlMode(std::ostream &os, const control value)
+{
+    rang_implementation::setStreamModes(os, rang_implementation::controlBits,
+                                        static_cast<long>(value) + 1);
+}
+
+// Back to the global control and Windows terminal modes for os
+inline void clearStreamModes(std::ostream &os)
+{
+    rang_implementation::setStreamModes(
+      os,
+      rang_implementation::controlBits | rang_implementation::winTermBits, 0);
+}
+
+/* Overrides the control mode of a stream for the lifetime of the scope and
+ * restores the previous override, or the lack of one, afterwards:
+ *
+ *   {
+ *       rang::controlScope plain(std::cout, rang::control::Off);
+ *       std::cout << rang::fg::red << "no colors here";
+ *   }
+ */
+class controlScope {
+public:
+    controlScope(std::ostream &os, const control value)
+        : os_(os)
+        , saved_(os.iword(rang_implementation::modeSlot())
+                 & rang_implementation::controlBits)
+    {
+        setControlMode(os, value);
+    }
+
+    controlScope(const controlScope &) = delete;
+    controlScope &operator=(const controlScope &) = delete;
+
+    ~controlScope()
+    {
+        rang_implementation::setStreamModes(
+          os_, rang_implementation::controlBits, saved_);
+    }
+
+private:
+    std::ostream &os_;
+    long saved_;
+};
+
+/* Builds a line in a thread local buffer and writes it to os with a single
+ * write when destroyed, so lines from several threads never interleave:
+ *
+ *   rang::line(std::cout) << rang::fg::red << "failed: " << code
+ *                         << rang::style::reset << '\n';
+ *
+ * Building takes no lock, only the final write is serialized with other
+ * lines for the same streambuf. Colors are decided when the line is
+ * written, as if its parts had been inserted into os directly; on Windows
+ * they are only kept if os receives escape sequences.
+ */
+class line {
+public:
+    explicit line(std::ostream &os) : os_(os), owned_(false)
+    {
+        using rang_implementation::lineStorage;
+        storage_ = &rang_implementation::threadLineStorage();
+        if (storage_->inUse) {
+            // A line built while writing another one on the same thread
+            storage_ = new lineStorage();
+            owned_   = true;
+        }
+        storage_->inUse = true;
+        storage_->buf.clear();
+        // Manipulators of an earlier line on this thread don't carry over
+        std::ostream &out = storage_->os;
+        out.clear();
+        out.flags(std::ios_base::dec | std::ios_base::skipws);
+        out.width(0);
+        out.precision(6);
+        out.fill(' ');
+    }
+
+    line(const line &) = delete;
+    line &operator=(const line &) = delete;
+
+    ~line()
+    {
+        try {
+            commit();
+        } catch (...) {
+        }
+        storage_->inUse = false;
+        if (owned_) {
+            delete storage_;
+        }
+    }
+
+    template <typename T>
+    line &operator<<(const T &value)
+    {
+        storage_->os << value;
+        return *this;
+    }
+
+    line &operator<<(std::ostream &(*manip)(std::ostream &))
+    {
+        storage_->os << manip;
+        return *this;
+    }
+
+private:
+    void commit()
+    {
+        const std::streamsize n = static_cast<std::streamsize>(
+          storage_->buf.size());
+        if (n != 0) {
+            rang_implementation::writeLine(os_, storage_->buf.data(), n);
+        }
+    }
+
+    std::ostream &os_;
+    rang_implementation::lineStorage *storage_;
+    bool owned_;
+};
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304L
+
+namespace rang_implementation {
+
+    struct markupName {
+        const char *name;
+        unsigned char code;
+    };
+
+    constexpr markupName markupStyles[]
+      = { { "reset", 0 },    { "bold", 1 },      { "dim", 2 },
+          { "italic", 3 },   { "underline", 4 }, { "blink", 5 },
+          { "rblink", 6 },   { "reversed", 7 },  { "conceal", 8 },
+          { "crossed", 9 } };
+
+    constexpr markupName markupColors[]
+      = { { "black", 0 }, { "red", 1 },     { "green", 2 }, { "yellow", 3 },
+          { "blue", 4 },  { "magenta", 5 }, { "cyan", 6 },  { "gray", 7 } };
+
+    constexpr markupName markupPrefixes[]
+      = { { "fg:", 30 }, { "bg:", 40 }, { "fgB:", 90 }, { "bgB:", 100 } };
+
+    // Whether s[0..size) is name
+    constexpr bool isName(const char *s, const std::size_t size,
+                          const char *name) noexcept
+    {
+        std::size_t i = 0;
+        for (; i < size; ++i) {
+            if (name[i] == '\0' || name[i] != s[i]) {
+                return false;
+            }
+        }
+        return name[i] == '\0';
+    }
+
+    /* SGR code of one name in a markup tag: a style like "bold", a color
+     * like "red" for fg or a color with the enum it belongs to, "fg:red",
+     * "bg:red", "fgB:red" or "bgB:red". "fg:reset" and "bg:reset" reset
+     * just the color.
+     */
+    constexpr unsigned markupCode(const char *s, const std::size_t size)
+    {
+        unsigned base    = 0;
+        std::size_t skip = 0;
+        for (const markupName &prefix : markupPrefixes) {
+            const std::size_t length = prefix.name[3] == '\0' ? 3 : 4;
+            if (size > length && isName(s, length, prefix.name)) {
+                base = prefix.code;
+                skip = length;
+            }
+        }
+        if (base == 0) {
+            for (const markupName &style : markupStyles) {
+                if (isName(s, size, style.name)) {
+                    return style.code;
+                }
+            }
+        } else if (base < 90 && isName(s + skip, size - skip, "reset")) {
+            return base + 9;
+        }
+        for (const markupName &color : markupColors) {
+            if (isName(s + skip, size - skip, color.name)) {
+                return (base == 0 ? 30 : base) + color.code;
+            }
+        }
+        throw std::invalid_argument("rang::markup: unknown name in a tag");
+    }
+
+}  // namespace rang_implementation
+
+template <std::size_t N, typename... Args>
+struct markupCall;
+
+/* A markup template parsed at compile time, made with rang::markup:
+ *
+ *   constexpr auto failed = rang::markup("<red,bold>ERROR</>: {}\n");
+ *   std::cout << failed(reason);
+ *
+ * A tag holds comma separated names (see markupCode) and becomes one
+ * escape sequence, </> resets everything. {} is replaced by the next
+ * argument, written with operator<<, and <<, {{ and }} stand for <, { and
+ * }. The template keeps its text with escapes and without and writes the
+ * one that fits the stream, so a constexpr template does no parsing at
+ * runtime. Mistakes in the markup are compile errors in constexpr
+ * templates and throw std::invalid_argument otherwise, as does calling
+ * it with more or fewer arguments than {}; RANG_MARKUP makes that a
+ * compile error too.
+ */
+template <std::size_t N>
+class markupTemplate {
+public:
+    static constexpr std::size_t maxArgs = N / 2;
+
+    constexpr explicit markupTemplate(const char (&text)[N])
+        : colored_{}, plain_{}, coloredEnds_{}, plainEnds_{}, args_(0)
+    {
+        parse(text);
+    }
+
+    constexpr std::size_t args() const noexcept { return args_; }
+
+    // The text for streams with or without colors
+    constexpr const char *text(const bool colors) const noexcept
+    {
+        return colors ? colored_ : plain_;
+    }
+
+    /* Where the text in front of each {} ends, ends(colors)[args()] is the
+     * end of the whole text
+     */
+    constexpr const std::size_t *ends(const bool colors) const noexcept
+    {
+        return colors ? coloredEnds_ : plainEnds_;
+    }
+
+    template <typename... Args>
+    markupCall<N, Args...> operator()(const Args &... args) const
+    {
+        if (sizeof...(Args) != args_) {
+            throw std::invalid_argument(
+              "rang::markup: one argument is needed for each {}");
+        }
+        return markupCall<N, Args...>(*this, args...);
+    }
+
+private:
+    constexpr void parse(const char (&text)[N])
+    {
+        std::size_t colored  = 0;
+        std::size_t plain    = 0;
+        std::size_t sequence = N;  // end of the last escape written
+        for (std::size_t i = 0; i + 1 < N; ++i) {
+            const char c = text[i];
+            const char d = text[i + 1];
+            if ((c == '{' && d == '{') || (c == '}' && d == '}')
+                || (c == '<' && d == '<')) {
+                colored_[colored++] = c;
+                plain_[plain++]     = c;
+                ++i;
+            } else if (c == '{' && d == '}') {
+                coloredEnds_[args_] = colored;
+                plainEnds_[args_]   = plain;
+                ++args_;
+                ++i;
+                sequence = N;  // the argument separates the tags around it
+            } else if (c == '{' || c == '}') {
+                throw std::invalid_argument("rang::markup: unmatched brace");
+            } else if (c == '<') {
+                // Tags right after each other share one escape sequence
+                if (sequence == colored) {
+                    colored_[colored - 1] = ';';
+                } else {
+                    colored_[colored++] = '\033';
+                    colored_[colored++] = '[';
+                }
+                i        = parseTag(text, i + 1, colored);
+                sequence = colored;
+            } else {
+                colored_[colored++] = c;
+                plain_[plain++]     = c;
+            }
+        }
+        coloredEnds_[args_] = colored;
+        plainEnds_[args_]   = plain;
+    }
+
+    // Writes the codes of the tag starting at text[i] and a final 'm',
+    // returns the position of its '>'
+    constexpr std::size_t parseTag(const char (&text)[N], std::size_t i,
+                                   std::size_t &colored)
+    {
+        if (text[i] == '/' && text[i + 1] == '>') {
+            colored_[colored++] = '0';
+            colored_[colored++] = 'm';
+            return i + 1;
+        }
+        for (;;) {
+            std::size_t end = i;
+            while (end + 1 < N && text[end] != ',' && text[end] != '>') {
+                ++end;
+            }
+            if (end + 1 >= N) {
+                throw std::invalid_argument("rang::markup: unclosed tag");
+            }
+            const unsigned code
+              = rang_implementation::markupCode(text + i, end - i);
+            if (code >= 100) {
+                colored_[colored++] = '1';
+            }
+            if (code >= 10) {
+                colored_[colored++] = static_cast<char>('0' + code / 10 % 10);
+            }
+            colored_[colored++] = static_cast<char>('0' + code % 10);
+            if (text[end] == '>') {
+                colored_[colored++] = 'm';
+                return end;
+            }
+            colored_[colored++] = ';';
+            i                   = end + 1;
+        }
+    }
+
+    // An escape is at most one byte longer than its tag, as for "</>"
+    char colored_[2 * N];
+    char plain_[N];
+    std::size_t coloredEnds_[maxArgs + 1];
+    std::size_t plainEnds_[maxArgs + 1];
+    std::size_t args_;
+};
+
+template <std::size_t N>
+constexpr markupTemplate<N> markup(const char (&text)[N])
+{
+    return markupTemplate<N>(text);
+}
+
+/* A markup template that knows its number of {} at compile time, made
+ * with RANG_MARKUP, which checks the arguments of each call against it:
+ *
+ *   const auto &failed = RANG_MARKUP("<red>ERROR</>: {} ({})\n");
+ *   std::cout << failed(reason, code);
+ *
+ * RANG_MARKUP parses the text once into a static and refers to it.
+ */
+template <std::size_t N, std::size_t Args>
+class checkedMarkup : public markupTemplate<N> {
+public:
+    constexpr explicit checkedMarkup(const markupTemplate<N> &tpl)
+        : markupTemplate<N>(tpl)
+    {
+    }
+
+    template <typename... CallArgs>
+    markupCall<N, CallArgs...> operator()(const CallArgs &... args) const
+    {
+        static_assert(sizeof...(CallArgs) == Args,
+                      "rang::markup: one argument is needed for each {}");
+        return markupCall<N, CallArgs...>(*this, args...);
+    }
+};
+
+#define RANG_MARKUP(text)                                                      \
+    ([]() -> const auto & {                                                    \
+        static constexpr ::rang::checkedMarkup<sizeof(text),                   \
+                                               ::rang::markup(text).args()>    \
+          rangMarkup(::rang::markup(text));                                    \
+        return rangMarkup;                                                     \
+    }())
+
+/* A markup template with its arguments, written with operator<<. Both
+ * are referenced, so a call has to be written before a temporary template
+ * or temporary arguments go away; constexpr templates and RANG_MARKUP
+ * ones live long enough.
+ */
+template <std::size_t N, typename... Args>
+struct markupCall {
+    markupCall(const markupTemplate<N> &tpl, const Args &... args)
+        : tpl(tpl), args(args...)
+    {
+    }
+
+    const markupTemplate<N> &tpl;
+    std::tuple<const Args &...> args;
+};
+
+namespace rang_implementation {
+
+    // Text up to {} number I and the argument for it
+    template <std::size_t I, std::size_t N, typename... Args>
+    inline void writeMarkupArg(std::ostream &os,
+                               const markupCall<N, Args...> &call,
+                               const char *text, const std::size_t *ends,
+                               std::size_t &start)
+    {
+        if (I < call.tpl.args()) {
+            os.write(text + start,
+                     static_cast<std::streamsize>(ends[I] - start));
+            os << std::get<I>(call.args);
+            start = ends[I];
+        }
+    }
+
+    template <std::size_t N, typename... Args, std::size_t... Is>
+    inline void writeMarkup(std::ostream &os,
+                            const markupCall<N, Args...> &call,
+                            indexSeq<Is...>)
+    {
+        const bool colors       = shouldColorize(os) && writesAnsi(os);
+        const char *text        = call.tpl.text(colors);
+        const std::size_t *ends = call.tpl.ends(colors);
+        std::size_t start       = 0;
+        const int expand[]      = { 0,
+                               (writeMarkupArg<Is>(os, call, text, ends, start),
+                                0)... };
+        (void)expand;
+        // The rest in one piece, {} without an argument (NDEBUG) left empty
+        const std::size_t end = ends[call.tpl.args()];
+        os.write(text + start, static_cast<std::streamsize>(end - start));
+    }
+
+}  // namespace rang_implementation
+
+template <std::size_t N, typename... Args>
+inline std::ostream &operator<<(std::ostream &os,
+                                const markupCall<N, Args...> &call)
+{
+    rang_implementation::writeMarkup(
+      os, call,
+      typename rang_implementation::makeIndexSeq<sizeof...(Args)>::type());
+    return os;
+}
+
+#endif
+
+}  // namespace rang
+
+#ifndef RANG_COMPILED
+#include "ostream-inl.hpp"
+#endif
+
+#endif /* ifndef RANG_OSTREAM_DOT_HPP */
@@ -0,0 +1,413 @@
+#ifndef RANG_PROGRESS_DOT_HPP
+#define RANG_PROGRESS_DOT_HPP
+
+#include "ostream.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rang {
+
+class progressBoard;
+
+/* One line of a progressBoard. Worker threads count on it with add or set,
+ * which are a single relaxed atomic operation each; only the board's
+ * thread reads the counter, when it redraws. A total of 0 makes a spinner
+ * that turns whenever the count moves.
+ */
+class progressBar {
+public:
+    progressBar(const progressBar &) = delete;
+    progressBar &operator=(const progressBar &) = delete;
+
+    void add(const std::uint64_t n = 1) noexcept
+    {
+        done_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void set(const std::uint64_t n) noexcept
+    {
+        done_.store(n, std::memory_order_relaxed);
+    }
+
+    void finish() noexcept { finished_.store(true, std::memory_order_release); }
+
+    std::uint64_t done() const noexcept
+    {
+        return done_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t total() const noexcept { return total_; }
+
+    bool finished() const noexcept
+    {
+        return finished_.load(std::memory_order_acquire);
+    }
+
+private:
+    friend class progressBoard;
+
+    progressBar(const std::string &label, const std::uint64_t total,
+                const styleSet &style)
+        : label_(label)
+        , total_(total)
+        , style_(style)
+        , done_(0)
+        , finished_(false)
+        , shownDone_(0)
+        , shownFinished_(false)
+        , spin_(0)
+    {
+    }
+
+    const std::string label_;
+    const std::uint64_t total_;
+    const styleSet style_;
+    std::atomic<std::uint64_t> done_;
+    std::atomic<bool> finished_;
+
+    // What the board drew last, board only
+    std::uint64_t shownDone_;
+    bool shownFinished_;
+    unsigned spin_;
+};
+
+/* Progress bars and spinners for long running jobs:
+ *
+ *   rang::progressBoard board(std::cerr);
+ *   rang::progressBar &files = board.add("files", count, rang::fg::green);
+ *   // on any thread
+ *   files.add();
+ *
+ * A background thread redraws at most once per interval. On a terminal
+ * (where os gets cursor control) it keeps the last frame and rewrites only
+ * the cells that changed, colors following the same decision as
+ * operator<<. Lines must fit the terminal's width. On anything else it
+ * prints the bars that moved as plain lines once per plainInterval.
+ * Nothing else may write to os while the board exists; the destructor
+ * draws the final state.
+ */
+class progressBoard {
+public:
+    explicit progressBoard(std::ostream &os,
+                           const std::chrono::milliseconds interval
+                           = std::chrono::milliseconds(100),
+                           const std::chrono::milliseconds plainInterval
+                           = std::chrono::milliseconds(5000),
+                           const unsigned barWidth = 30)
+        : os_(os)
+        , interval_(interval)
+        , plainInterval_(plainInterval)
+        , barWidth_(barWidth)
+        , terminal_(rang_implementation::shouldControl(os)
+                    && rang_implementation::writesAnsi(os))
+        , barCount_(0)
+        , row_(0)
+        , lastPlain_(std::chrono::steady_clock::now())
+        , colors_(false)
+        , stop_(false)
+    {
+        drawer_ = std::thread([this] { run(); });
+    }
+
+    progressBoard(const progressBoard &) = delete;
+    progressBoard &operator=(const progressBoard &) = delete;
+
+    ~progressBoard()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        drawer_.join();
+        draw(true);
+    }
+
+    // A new bar below the others, usable until the board is destroyed
+    progressBar &add(const std::string &label, const std::uint64_t total,
+                     const styleSet &style = styleSet(fg::green))
+    {
+        std::unique_ptr<progressBar> bar(new progressBar(label, total, style));
+        progressBar &added = *bar;
+        std::lock_guard<std::mutex> lock(barsMutex_);
+        bars_.push_back(std::move(bar));
+        barCount_.store(bars_.size(), std::memory_order_release);
+        return added;
+    }
+
+    // Draws now instead of at the next interval, also in plain mode
+    void refresh() { draw(true); }
+
+    // Whether the board rewrites cells in place rather than printing lines
+    bool terminal() const noexcept { return terminal_; }
+
+private:
+    enum cellKind : char { plainCell, fillCell, emptyCell };
+
+    // Text and cell kinds of a line
+    struct frame {
+        std::string text;
+        std::string kinds;
+    };
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            wake_.wait_for(lock, interval_);
+            if (!stop_) {
+                lock.unlock();
+                draw(false);
+                lock.lock();
+            }
+        }
+    }
+
+    void append(frame &line, const std::string &text, const cellKind kind)
+    {
+        line.text += text;
+        line.kinds.append(text.size(), kind);
+    }
+
+    frame layout(progressBar &bar, const std::uint64_t done,
+                 const bool finished)
+    {
+        frame line;
+        append(line, bar.label_ + ' ', plainCell);
+        if (bar.total_ == 0) {
+            static const char spinner[] = { '|', '/', '-', '\\' };
+            if (done != bar.shownDone_) {
+                ++bar.spin_;
+            }
+            const char head = finished ? '*' : spinner[bar.spin_ % 4];
+            append(line, std::string(1, head), fillCell);
+            append(line, ' ' + std::to_string(done), plainCell);
+            return line;
+        }
+        const std::uint64_t shown = done < bar.total_ ? done : bar.total_;
+        const unsigned filled     = static_cast<unsigned>(
+          shown * barWidth_ / bar.total_);
+        append(line, "[", plainCell);
+        append(line, std::string(filled, '#'), fillCell);
+        append(line, std::string(barWidth_ - filled, '-'), emptyCell);
+        std::string percent = std::to_string(shown * 100 / bar.total_);
+        percent.insert(0, 3 - percent.size(), ' ');
+        append(line, "] " + percent + "% " + std::to_string(done) + '/'
+                 + std::to_string(bar.total_),
+               plainCell);
+        return line;
+    }
+
+    /* Escape switching from kind from to kind to, the fill color being
+     * style, nothing without colors.
+     */
+    void switchKind(const char from, const char to, const escape &style)
+    {
+        if (from == to || !colors_) {
+            return;
+        }
+        if (from != plainCell) {
+            out_ += "\033[0m";
+        }
+        if (to == fillCell) {
+            out_.append(style.data(), style.size());
+        } else if (to == emptyCell) {
+            out_ += "\033[2m";
+        }
+    }
+
+    void writeCells(const frame &line, const std::size_t first,
+                    const std::size_t last, const escape &style)
+    {
+        char kind = plainCell;
+        for (std::size_t i = first; i < last; ++i) {
+            switchKind(kind, line.kinds[i], style);
+            kind = line.kinds[i];
+            out_ += line.text[i];
+        }
+        switchKind(kind, plainCell, style);
+    }
+
+    /* Moves the cursor to the start of row to. The rows exist already, so
+     * this never scrolls. Between draws the cursor waits at the start of
+     * the row below the last line, where nothing needs to move.
+     */
+    void moveTo(const std::size_t to)
+    {
+        if (to == row_) {
+            return;
+        }
+        if (to > row_) {
+            control(cursorDown(static_cast<unsigned>(to - row_)));
+        } else {
+            control(cursorUp(static_cast<unsigned>(row_ - to)));
+        }
+        out_ += '\r';
+        row_ = to;
+    }
+
+    template <typename T>
+    void control(const T &value)
+    {
+        char seq[rang_implementation::maxControlSize];
+        out_.append(seq, rang_implementation::encodeControl(seq, value));
+    }
+
+    static bool sameCell(const frame &line, const frame &old,
+                         const std::size_t i) noexcept
+    {
+        return i < old.text.size() && line.text[i] == old.text[i]
+          && line.kinds[i] == old.kinds[i];
+    }
+
+    /* Rewrites the runs of cells that differ from what the terminal shows.
+     * Runs closer than gapCells are written as one, jumping over fewer
+     * cells takes more bytes than writing them again.
+     */
+    void drawTerminal(const std::size_t index, const frame &line,
+                      const escape &style)
+    {
+        static constexpr std::size_t gapCells = 4;
+        if (index == shown_.size()) {
+            // Below the others, the cursor waits at the start of that row
+            moveTo(index);
+            writeCells(line, 0, line.text.size(), style);
+            out_ += '\n';
+            ++row_;
+            shown_.push_back(line);
+            return;
+        }
+        frame &old          = shown_[index];
+        const std::size_t n = line.text.size();
+        std::size_t column  = 0;
+        bool moved          = false;
+        std::size_t i       = 0;
+        for (;;) {
+            while (i < n && sameCell(line, old, i)) {
+                ++i;
+            }
+            if (i == n) {
+                break;
+            }
+            std::size_t end = i;
+            for (;;) {
+                while (end < n && !sameCell(line, old, end)) {
+                    ++end;
+                }
+                std::size_t next = end;
+                while (next < n && sameCell(line, old, next)) {
+                    ++next;
+                }
+                if (next == n || next - end >= gapCells) {
+                    break;
+                }
+                end = next;
+            }
+            if (!moved) {
+                moveTo(index);
+                moved = true;
+            }
+            if (i > column) {
+                control(cursorForward(static_cast<unsigned>(i - column)));
+            }
+            writeCells(line, i, end, style);
+            column = i = end;
+        }
+        if (n < old.text.size()) {
+            if (!moved) {
+                moveTo(index);
+            }
+            if (n > column) {
+                control(cursorForward(static_cast<unsigned>(n - column)));
+            }
+            control(erase::lineEnd);
+        }
+        old = line;
+    }
+
+    void draw(const bool now)
+    {
+        std::lock_guard<std::mutex> lock(drawMutex_);
+        const std::size_t count = barCount_.load(std::memory_order_acquire);
+        if (snapshot_.size() != count) {
+            std::lock_guard<std::mutex> barsLock(barsMutex_);
+            snapshot_.clear();
+            for (const std::unique_ptr<progressBar> &bar : bars_) {
+                snapshot_.push_back(bar.get());
+            }
+        }
+        const auto clock = std::chrono::steady_clock::now();
+        if (!terminal_ && !now && clock - lastPlain_ < plainInterval_) {
+            return;
+        }
+
+        colors_ = rang_implementation::shouldColorize(os_)
+          && rang_implementation::writesAnsi(os_);
+        out_.clear();
+        for (std::size_t i = 0; i < snapshot_.size(); ++i) {
+            progressBar &bar    = *snapshot_[i];
+            const bool finished = bar.finished();
+            const std::uint64_t done = bar.done();
+            const bool moved
+              = done != bar.shownDone_ || finished != bar.shownFinished_;
+            if (terminal_ ? !moved && i < shown_.size() : !moved) {
+                continue;
+            }
+            const frame line = layout(bar, done, finished);
+            if (terminal_) {
+                drawTerminal(i, line, escape(bar.style_));
+            } else {
+                out_ += line.text;
+                out_ += '\n';
+            }
+            bar.shownDone_     = done;
+            bar.shownFinished_ = finished;
+        }
+        if (terminal_ && row_ != shown_.size()) {
+            moveTo(shown_.size());
+        }
+        if (!terminal_) {
+            lastPlain_ = clock;
+        }
+        if (!out_.empty()) {
+            os_.write(out_.data(), static_cast<std::streamsize>(out_.size()));
+            os_.flush();
+        }
+    }
+
+    std::ostream &os_;
+    const std::chrono::milliseconds interval_;
+    const std::chrono::milliseconds plainInterval_;
+    const unsigned barWidth_;
+    const bool terminal_;
+
+    std::mutex barsMutex_;
+    std::vector<std::unique_ptr<progressBar>> bars_;
+    std::atomic<std::size_t> barCount_;
+
+    // Drawing state, guarded by drawMutex_
+    std::mutex drawMutex_;
+    std::vector<progressBar *> snapshot_;
+    std::vector<frame> shown_;  // lines on the terminal
+    std::size_t row_;           // cursor row, counted from the first line
+    std::chrono::steady_clock::time_point lastPlain_;
+    bool colors_;
+    std::string out_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_;  // guarded by mutex_
+    std::thread drawer_;
+};
+
+}  // namespace rang
+
+#endif /* ifndef RANG_PROGRESS_DOT_HPP */
@@ -0,0 +1,279 @@
+#ifndef RANG_TABLE_DOT_HPP
+#define RANG_TABLE_DOT_HPP
+
+#include "ostream.hpp"
+#include "width.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#endif
+
+namespace rang {
+
+/* Colored tables with columns lined up on what the terminal shows:
+ *
+ *   rang::table hosts(std::cout);
+ *   hosts.column("host").column("load", rang::align::right);
+ *   hosts.cell("db1").cell(rang::fg::red, "0.97").endRow();
+ *
+ * Cells are (style, text) pairs kept in one arena. Widths are counted in
+ * display columns, escapes in the text taking none and wide characters
+ * two, over the titles and the first sampleRows rows, which are held back
+ * until then. Later rows are written as they end, one write per row, so
+ * large results never sit in memory; their cells are cut to the column
+ * with an ellipsis. Columns given a width keep it; columns the sample
+ * left empty, or that only appear after it, get fallbackWidth. flush, or
+ * the destructor, writes what is held back.
+ */
+class table {
+public:
+    // Width of columns the sample has no text for
+    static constexpr std::size_t fallbackWidth = 8;
+
+    explicit table(std::ostream &os, const std::size_t sampleRows = 256,
+                   const styleSet &titleStyle = styleSet(style::bold))
+        : os_(os)
+        , sampleRows_(sampleRows)
+        , titleStyle_(titleStyle)
+        , sampling_(true)
+        , titled_(false)
+        , colors_(false)
+        , rowCells_(0)
+        , kept_(0)
+    {
+    }
+
+    table(const table &) = delete;
+    table &operator=(const table &) = delete;
+
+    ~table() { flush(); }
+
+    // Adds a column, width 0 for one measured from the sample
+    table &column(const std::string &title, const align where = align::left,
+                  const std::size_t width = 0)
+    {
+        const std::size_t titleWidth = visibleWidth(title.data(), title.size());
+        columns_.push_back({ title, where, width,
+                             width != 0 ? width : titleWidth });
+        titled_ = true;
+        return *this;
+    }
+
+    table &cell(const styleSet &style, const char *text,
+                const std::size_t size)
+    {
+        cellRef ref;
+        ref.offset = static_cast<std::uint32_t>(arena_.size());
+        ref.codes  = static_cast<std::uint8_t>(style.count());
+        ref.size   = static_cast<std::uint32_t>(size);
+        ref.width  = static_cast<std::uint32_t>(visibleWidth(text, size));
+        arena_.append(reinterpret_cast<const char *>(style.codes()),
+                      style.count());
+        arena_.append(text, size);
+        cells_.push_back(ref);
+
+        if (rowCells_ == columns_.size()) {
+            columns_.push_back({ std::string(), align::left, 0,
+                                 sampling_ ? 0 : fallbackWidth });
+        }
+        columnInfo &col = columns_[rowCells_++];
+        if (sampling_ && col.fixed == 0 && ref.width > col.width) {
+            col.width = ref.width;
+        }
+        return *this;
+    }
+
+    table &cell(const styleSet &style, const std::string &text)
+    {
+        return cell(style, text.data(), text.size());
+    }
+
+    table &cell(const styleSet &style, const char *text)
+    {
+        return cell(style, text, std::strlen(text));
+    }
+
+    table &cell(const std::string &text) { return cell(styleSet(), text); }
+
+    table &cell(const char *text) { return cell(styleSet(), text); }
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    table &cell(const styleSet &style, const std::string_view text)
+    {
+        return cell(style, text.data(), text.size());
+    }
+
+    table &cell(const std::string_view text)
+    {
+        return cell(styleSet(), text.data(), text.size());
+    }
+#endif
+
+    // Ends the row, written right away once the widths are known
+    table &endRow()
+    {
+        rowEnds_.push_back(cells_.size());
+        rowCells_ = 0;
+        if (!sampling_) {
+            writeRows();
+        } else if (rowEnds_.size() >= sampleRows_) {
+            flush();
+        }
+        return *this;
+    }
+
+    // Fixes the widths if they aren't yet and writes the rows held back
+    void flush()
+    {
+        if (rowCells_ != 0) {
+            endRow();
+        }
+        if (sampling_) {
+            sampling_ = false;
+            for (columnInfo &col : columns_) {
+                col.width = col.width != 0 ? col.width : fallbackWidth;
+            }
+            colors_   = rang_implementation::shouldColorize(os_)
+              && rang_implementation::writesAnsi(os_);
+            if (titled_) {
+                writeTitles();
+            }
+        }
+        writeRows();
+        os_.flush();
+    }
+
+private:
+    struct columnInfo {
+        std::string title;
+        align where;
+        std::size_t fixed;
+        std::size_t width;
+    };
+
+    // A cell in the arena: its SGR codes, then its text
+    struct cellRef {
+        std::uint32_t offset;
+        std::uint32_t size;
+        std::uint32_t width;
+        std::uint8_t codes;
+    };
+
+    void writeStyle(const unsigned char *codes, const std::size_t count)
+    {
+        unsigned char changed[styleSet::maxCodes];
+        char seq[4 + 4 * styleSet::maxCodes];
+        const std::size_t n = rang_implementation::downsample(
+          codes, count, rang_implementation::colorLevelSetting(), changed);
+        line_.append(seq, rang_implementation::writeSequence(seq, changed, n));
+    }
+
+    /* Appends text in the column, cut or padded to its width. The last
+     * column gets no padding after the text.
+     */
+    void writeCell(const std::size_t index, const unsigned char *codes,
+                   const std::size_t count, const char *text,
+                   const std::size_t size, const std::size_t width)
+    {
+        const columnInfo &col = columns_[index];
+        std::size_t shown     = size;
+        std::size_t used      = width;
+        bool cut              = false;
+        if (width > col.width) {
+            cut   = true;
+            shown = col.width == 0 ? 0
+                                   : rang_implementation::fitWidth(
+                                     text, size, col.width - 1, used);
+            used += col.width == 0 ? 0 : 1;
+        }
+        const std::size_t pad = col.width - used;
+        const bool last       = index + 1 == columns_.size();
+        const bool styled     = colors_ && count != 0;
+        if (index != 0) {
+            line_.append(2, ' ');
+        }
+        if (col.where == align::right) {
+            line_.append(pad, ' ');
+        }
+        if (styled) {
+            writeStyle(codes, count);
+        }
+        line_.append(text, shown);
+        if (cut && col.width != 0) {
+            line_ += "\xE2\x80\xA6";  // U+2026, one column
+        }
+        if (styled) {
+            line_ += "\033[0m";
+        }
+        if (styled || shown != 0) {
+            kept_ = line_.size();
+        }
+        if (col.where == align::left && !last) {
+            line_.append(pad, ' ');
+        }
+    }
+
+    // Writes the line without the padding after its last text
+    void writeLine()
+    {
+        line_.resize(kept_);
+        line_ += '\n';
+        os_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+        line_.clear();
+        kept_ = 0;
+    }
+
+    void writeTitles()
+    {
+        for (std::size_t i = 0; i < columns_.size(); ++i) {
+            const columnInfo &col = columns_[i];
+            writeCell(i, titleStyle_.codes(), titleStyle_.count(),
+                      col.title.data(), col.title.size(),
+                      visibleWidth(col.title.data(), col.title.size()));
+        }
+        writeLine();
+    }
+
+    void writeRows()
+    {
+        std::size_t first = 0;
+        for (const std::size_t end : rowEnds_) {
+            for (std::size_t i = first; i < end; ++i) {
+                const cellRef &ref = cells_[i];
+                const char *at     = &arena_[ref.offset];
+                writeCell(i - first,
+                          reinterpret_cast<const unsigned char *>(at),
+                          ref.codes, at + ref.codes, ref.size, ref.width);
+            }
+            writeLine();
+            first = end;
+        }
+        rowEnds_.clear();
+        cells_.clear();
+        arena_.clear();
+    }
+
+    std::ostream &os_;
+    const std::size_t sampleRows_;
+    const styleSet titleStyle_;
+    bool sampling_;
+    bool titled_;
+    bool colors_;
+
+    std::vector<columnInfo> columns_;
+    std::string arena_;
+    std::vector<cellRef> cells_;
+    std::vector<std::size_t> rowEnds_;  // one past the last cell of each row
+    std::size_t rowCells_;              // cells in the row being built
+    std::string line_;
+    std::size_t kept_;  // end of the last cell text in line_
+};
+
+}  // namespace rang
+
+#endif /* ifndef RANG_TABLE_DOT_HPP */
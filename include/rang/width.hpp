@@ -0,0 +1,391 @@
+#ifndef RANG_WIDTH_DOT_HPP
+#define RANG_WIDTH_DOT_HPP
+
+/* Display width of UTF-8 text that may contain escape sequences: escapes
+ * take no columns, East Asian wide characters and emoji take two,
+ * combining marks and zero width characters none. The tables are compact
+ * range lists covering what terminals commonly agree on, not all of
+ * Unicode.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#endif
+
+namespace rang {
+
+enum class align {  // Where padded text sits in its columns
+    left  = 0,
+    right = 1
+};
+
+namespace rang_implementation {
+
+    struct codepointRange {
+        std::uint32_t first;
+        std::uint32_t last;
+    };
+
+    // Binary search of sorted, disjoint ranges
+    template <std::size_t N>
+    inline bool inRanges(const codepointRange (&ranges)[N],
+                         const std::uint32_t cp) noexcept
+    {
+        std::size_t low  = 0;
+        std::size_t high = N;
+        while (low < high) {
+            const std::size_t mid = (low + high) / 2;
+            if (cp > ranges[mid].last) {
+                low = mid + 1;
+            } else if (cp < ranges[mid].first) {
+                high = mid;
+            } else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool isZeroWidth(const std::uint32_t cp) noexcept
+    {
+        static constexpr codepointRange ranges[] = {
+            { 0x0300, 0x036F },   { 0x0483, 0x0489 },   { 0x0591, 0x05BD },
+            { 0x05BF, 0x05C7 },   { 0x0610, 0x061A },   { 0x064B, 0x065F },
+            { 0x0670, 0x0670 },   { 0x06D6, 0x06ED },   { 0x0900, 0x0903 },
+            { 0x093A, 0x094F },   { 0x0E31, 0x0E31 },   { 0x0E34, 0x0E3A },
+            { 0x0E47, 0x0E4E },   { 0x1AB0, 0x1AFF },   { 0x1DC0, 0x1DFF },
+            { 0x200B, 0x200F },   { 0x2028, 0x202E },   { 0x2060, 0x2064 },
+            { 0x20D0, 0x20FF },   { 0xFE00, 0xFE0F },   { 0xFE20, 0xFE2F },
+            { 0xFEFF, 0xFEFF },   { 0x1F3FB, 0x1F3FF }, { 0xE0000, 0xE0FFF }
+        };
+        return inRanges(ranges, cp);
+    }
+
+    inline bool isWide(const std::uint32_t cp) noexcept
+    {
+        static constexpr codepointRange ranges[] = {
+            { 0x1100, 0x115F },   { 0x231A, 0x231B },   { 0x2329, 0x232A },
+            { 0x23E9, 0x23EC },   { 0x23F0, 0x23F0 },   { 0x23F3, 0x23F3 },
+            { 0x25FD, 0x25FE },   { 0x2614, 0x2615 },   { 0x2648, 0x2653 },
+            { 0x267F, 0x267F },   { 0x2693, 0x2693 },   { 0x26A1, 0x26A1 },
+            { 0x26AA, 0x26AB },   { 0x26BD, 0x26BE },   { 0x26C4, 0x26C5 },
+            { 0x26CE, 0x26CE },   { 0x26D4, 0x26D4 },   { 0x26EA, 0x26EA },
+            { 0x26F2, 0x26F3 },   { 0x26F5, 0x26F5 },   { 0x26FA, 0x26FA },
+            { 0x26FD, 0x26FD },   { 0x2705, 0x2705 },   { 0x270A, 0x270B },
+            { 0x2728, 0x2728 },   { 0x274C, 0x274C },   { 0x274E, 0x274E },
+            { 0x2753, 0x2755 },   { 0x2757, 0x2757 },   { 0x2795, 0x2797 },
+            { 0x27B0, 0x27B0 },   { 0x27BF, 0x27BF },   { 0x2B1B, 0x2B1C },
+            { 0x2B50, 0x2B50 },   { 0x2B55, 0x2B55 },   { 0x2E80, 0x303E },
+            { 0x3041, 0x33FF },   { 0x3400, 0x4DBF },   { 0x4E00, 0x9FFF },
+            { 0xA000, 0xA4CF },   { 0xA960, 0xA97F },   { 0xAC00, 0xD7A3 },
+            { 0xF900, 0xFAFF },   { 0xFE10, 0xFE19 },   { 0xFE30, 0xFE6F },
+            { 0xFF00, 0xFF60 },   { 0xFFE0, 0xFFE6 },   { 0x16FE0, 0x16FE4 },
+            { 0x17000, 0x18CFF }, { 0x1B000, 0x1B2FF }, { 0x1F004, 0x1F004 },
+            { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A },
+            { 0x1F200, 0x1F251 }, { 0x1F300, 0x1F64F }, { 0x1F680, 0x1F6FF },
+            { 0x1F7E0, 0x1F7EB }, { 0x1F90C, 0x1F9FF }, { 0x1FA70, 0x1FAFF },
+            { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+        };
+        return inRanges(ranges, cp);
+    }
+
+    // Columns taken by a code point: 0, 1 or 2
+    inline unsigned codepointWidth(const std::uint32_t cp) noexcept
+    {
+        if (cp < 0x7F) {
+            return cp >= 0x20 ? 1 : 0;
+        }
+        if (cp < 0xA0) {
+            return 0;  // DEL and C1 controls
+        }
+        if (cp < 0x300) {
+            return 1;
+        }
+        if (isZeroWidth(cp)) {
+            return 0;
+        }
+        return isWide(cp) ? 2 : 1;
+    }
+
+    /* Decodes the UTF-8 sequence at p (p < end), returns its length. Bytes
+     * that don't start a valid sequence decode as themselves, one byte
+     * long, so broken text still gets a width.
+     */
+    inline std::size_t decodeUtf8(const unsigned char *p,
+                                  const unsigned char *end,
+                                  std::uint32_t &cp) noexcept
+    {
+        const unsigned char lead = *p;
+        std::size_t length       = 1;
+        std::uint32_t value      = lead;
+        if (lead >= 0xF0 && lead < 0xF5) {
+            length = 4;
+            value  = lead & 0x07;
+        } else if (lead >= 0xE0) {
+            length = lead < 0xF0 ? 3 : 1;
+            value  = lead & 0x0F;
+        } else if (lead >= 0xC2) {
+            length = 2;
+            value  = lead & 0x1F;
+        }
+        if (length == 1 || static_cast<std::size_t>(end - p) < length) {
+            cp = lead;
+            return 1;
+        }
+        for (std::size_t i = 1; i < length; ++i) {
+            if ((p[i] & 0xC0) != 0x80) {
+                cp = lead;
+                return 1;
+            }
+            value = (value << 6) | (p[i] & 0x3F);
+        }
+        cp = value;
+        return length;
+    }
+
+    /* Length of the escape sequence at p (*p is ESC): CSI sequences up to
+     * their final byte, OSC strings up to BEL or ST, two byte escapes
+     * otherwise. An unfinished sequence runs to end.
+     */
+    inline std::size_t escapeLength(const unsigned char *p,
+                                    const unsigned char *end) noexcept
+    {
+        const unsigned char *q = p + 1;
+        if (q == end) {
+            return 1;
+        }
+        if (*q == '[') {
+            for (++q; q != end; ++q) {
+                if (*q >= 0x40 && *q <= 0x7E) {
+                    return static_cast<std::size_t>(q + 1 - p);
+                }
+            }
+        } else if (*q == ']') {
+            for (++q; q != end; ++q) {
+                if (*q == 0x07) {
+                    return static_cast<std::size_t>(q + 1 - p);
+                }
+                if (*q == 0x1B && q + 1 != end && q[1] == '\\') {
+                    return static_cast<std::size_t>(q + 2 - p);
+                }
+            }
+        } else {
+            return 2;
+        }
+        return static_cast<std::size_t>(end - p);
+    }
+
+    /* Whether the 8 bytes at p are all printable ASCII, one column each.
+     * Words with a byte below 0x20, DEL or a byte from 0x80 up have the
+     * top bit of that byte set in the result.
+     */
+    inline bool printableWord(const unsigned char *p) noexcept
+    {
+        constexpr std::uint64_t ones = 0x0101010101010101ULL;
+        constexpr std::uint64_t tops = 0x8080808080808080ULL;
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof word);
+        const std::uint64_t del   = word ^ (ones * 0x7F);
+        const std::uint64_t below = (word - ones * 0x20) & ~word;
+        const std::uint64_t isDel = (del - ones) & ~del;
+        return ((word | below | isDel) & tops) == 0;
+    }
+
+    // Columns of the character at p, its length in length
+    inline unsigned charWidth(const unsigned char *p,
+                              const unsigned char *end,
+                              std::size_t &length) noexcept
+    {
+        if (*p < 0x80) {
+            length = 1;
+            return *p >= 0x20 && *p != 0x7F ? 1 : 0;
+        }
+        std::uint32_t cp;
+        length = decodeUtf8(p, end, cp);
+        return codepointWidth(cp);
+    }
+
+    // Next ESC from p on, end if there is none
+    inline const unsigned char *findEscape(const unsigned char *p,
+                                           const unsigned char *end) noexcept
+    {
+        const void *esc
+          = std::memchr(p, 0x1B, static_cast<std::size_t>(end - p));
+        return esc != nullptr ? static_cast<const unsigned char *>(esc) : end;
+    }
+
+    // Columns of text without escapes, printable ASCII a word at a time
+    inline std::size_t plainWidth(const unsigned char *p,
+                                  const unsigned char *end) noexcept
+    {
+        std::size_t width = 0;
+        while (p != end) {
+            if (end - p >= 8 && printableWord(p)) {
+                width += 8;
+                p += 8;
+                continue;
+            }
+            std::size_t length;
+            width += charWidth(p, end, length);
+            p += length;
+        }
+        return width;
+    }
+
+    inline std::size_t textWidth(const char *text,
+                                 const std::size_t size) noexcept
+    {
+        const unsigned char *p
+          = reinterpret_cast<const unsigned char *>(text);
+        const unsigned char *end = p + size;
+        std::size_t width        = 0;
+        while (p != end) {
+            const unsigned char *esc = findEscape(p, end);
+            width += plainWidth(p, esc);
+            p = esc == end ? end : esc + escapeLength(esc, end);
+        }
+        return width;
+    }
+
+    /* Bytes of text that fit in width columns, escapes included, and the
+     * columns they take in used. Never splits a character or escape.
+     */
+    inline std::size_t fitWidth(const char *text, const std::size_t size,
+                                const std::size_t width,
+                                std::size_t &used) noexcept
+    {
+        const unsigned char *begin
+          = reinterpret_cast<const unsigned char *>(text);
+        const unsigned char *p   = begin;
+        const unsigned char *end = begin + size;
+        used                     = 0;
+        while (p != end) {
+            const unsigned char *esc = findEscape(p, end);
+            while (p != esc) {
+                if (esc - p >= 8 && width - used >= 8 && printableWord(p)) {
+                    used += 8;
+                    p += 8;
+                    continue;
+                }
+                std::size_t length;
+                const unsigned columns = charWidth(p, esc, length);
+                if (used + columns > width) {
+                    return static_cast<std::size_t>(p - begin);
+                }
+                used += columns;
+                p += length;
+            }
+            if (esc != end) {
+                p = esc + escapeLength(esc, end);
+            }
+        }
+        return static_cast<std::size_t>(p - begin);
+    }
+
+}  // namespace rang_implementation
+
+/* Escape aware text measuring, for lining up text that may carry colors
+ * from rang or anyone else. None of them allocates; text is scanned for
+ * ESC with memchr and printable ASCII is counted eight bytes at a time.
+ */
+
+// Columns text takes on a terminal, escape sequences taking none
+inline std::size_t visibleWidth(const char *text,
+                                const std::size_t size) noexcept
+{
+    return rang_implementation::textWidth(text, size);
+}
+
+/* Length of the longest start of text that fits in width columns. Never
+ * splits a character or an escape; escapes right after the last character
+ * that fits are kept, a reset further on is not.
+ */
+inline std::size_t truncateVisible(const char *text, const std::size_t size,
+                                   const std::size_t width) noexcept
+{
+    std::size_t used;
+    return rang_implementation::fitWidth(text, size, width, used);
+}
+
+/* Copies text to buf with spaces before (align::right) or after it up to
+ * width columns, if it all fits in capacity. Returns the length either
+ * way, like escapeTo. Text wider than width is copied whole.
+ */
+inline std::size_t padVisible(char *buf, const std::size_t capacity,
+                              const char *text, const std::size_t size,
+                              const std::size_t width,
+                              const align where = align::left) noexcept
+{
+    const std::size_t shown = visibleWidth(text, size);
+    const std::size_t pad   = shown < width ? width - shown : 0;
+    if (size + pad <= capacity) {
+        const std::size_t at = where == align::right ? pad : 0;
+        std::memset(buf + (at == 0 ? size : 0), ' ', pad);
+        std::memcpy(buf + at, text, size);
+    }
+    return size + pad;
+}
+
+/* Calls visit(data, size, isEscape) for each run of text and each escape
+ * sequence of text in order, together covering all of it.
+ */
+template <typename Visitor>
+inline void splitEscapes(const char *text, const std::size_t size,
+                         Visitor &&visit)
+{
+    const unsigned char *begin = reinterpret_cast<const unsigned char *>(text);
+    const unsigned char *p     = begin;
+    const unsigned char *end   = begin + size;
+    while (p != end) {
+        const unsigned char *esc = rang_implementation::findEscape(p, end);
+        if (esc != p) {
+            visit(text + (p - begin), static_cast<std::size_t>(esc - p),
+                  false);
+        }
+        if (esc == end) {
+            break;
+        }
+        p = esc + rang_implementation::escapeLength(esc, end);
+        visit(text + (esc - begin), static_cast<std::size_t>(p - esc), true);
+    }
+}
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+inline std::size_t visibleWidth(const std::string_view text) noexcept
+{
+    return visibleWidth(text.data(), text.size());
+}
+
+inline std::string_view truncateVisible(const std::string_view text,
+                                        const std::size_t width) noexcept
+{
+    return text.substr(0, truncateVisible(text.data(), text.size(), width));
+}
+
+inline std::size_t padVisible(char *buf, const std::size_t capacity,
+                              const std::string_view text,
+                              const std::size_t width,
+                              const align where = align::left) noexcept
+{
+    return padVisible(buf, capacity, text.data(), text.size(), width, where);
+}
+
+// visit(std::string_view run, bool isEscape)
+template <typename Visitor>
+inline void splitEscapes(const std::string_view text, Visitor &&visit)
+{
+    splitEscapes(text.data(), text.size(),
+                 [&visit](const char *data, const std::size_t size,
+                          const bool isEscape) {
+                     visit(std::string_view(data, size), isEscape);
+                 });
+}
+#endif
+
+}  // namespace rang
+
+#endif /* ifndef RANG_WIDTH_DOT_HPP */
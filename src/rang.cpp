@@ -0,0 +1,9 @@
+// The platform and detection code of rang, built once for RANG_COMPILED.
+// Everything that uses the library must be compiled with it defined too.
+
+#ifndef RANG_COMPILED
+#define RANG_COMPILED
+#endif
+
+#include "rang/core-inl.hpp"
+#include "rang/ostream-inl.hpp"
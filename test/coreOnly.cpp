@@ -0,0 +1,23 @@
+// rang/core.hpp on its own: colors for FILE* and fds without iostreams
+#include "rang/core.hpp"
+#include <cstdio>
+#include <cstring>
+
+#if defined(_GLIBCXX_IOSTREAM) || defined(_LIBCPP_IOSTREAM)
+#error "rang/core.hpp must not include <iostream>"
+#endif
+
+int main()
+{
+    char seq[16];
+    const std::size_t n
+      = rang::escapeTo(seq, sizeof seq, rang::fg::green | rang::style::bold);
+    if (n != 7 || std::memcmp(seq, "\033[32;1m", n) != 0) {
+        return 1;
+    }
+
+    rang::fputStyle(rang::fg::green, stdout);
+    std::fputs("===COLORS WITHOUT IOSTREAMS===", stdout);
+    rang::fputStyle(rang::style::reset, stdout);
+    std::fputs("\n", stdout);
+}
@@ -0,0 +1,508 @@
+// Colors the severity markers of a log file, mapping it instead of reading
+// it and colorizing chunks of it on all cores:
+//
+//   logColorizer [--color=auto|always|never] [--threads=N] file
+//   logColorizer --check       colorizes a small log and checks the output
+//   logColorizer --bench=MB    GB/s on a synthetic log of MB megabytes
+#include "rang/core.hpp"
+#include "rang/mapped.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#elif defined(RANG_OS_WIN)
+#include <fcntl.h>
+#include <io.h>
+
+struct iovec {
+    void *iov_base;
+    std::size_t iov_len;
+};
+#endif
+
+using namespace std;
+using namespace rang;
+
+namespace {
+
+struct rule {
+    const char *marker;
+    styleSet style;
+};
+
+// First match wins, so longer markers come before their prefixes
+const rule rules[] = { { "FATAL", fg::red | style::bold },
+                       { "CRITICAL", fg::red | style::bold },
+                       { "ERROR", fg::red },
+                       { "WARNING", fg::yellow },
+                       { "WARN", fg::yellow },
+                       { "INFO", fg::green },
+                       { "DEBUG", style::dim },
+                       { "TRACE", style::dim } };
+
+constexpr size_t ruleCount = sizeof rules / sizeof rules[0];
+
+// Markers are looked for this far into each line, where log formats put them
+constexpr size_t scanWidth = 96;
+
+bool isWordByte(const unsigned char c)
+{
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')
+      || c == '_';
+}
+
+/* Finds the severity marker of a line: a whole word matching a rule's
+ * marker in any case. A table of the markers' first letters rejects most
+ * bytes with one lookup.
+ */
+class severityMatcher {
+public:
+    explicit severityMatcher(const bool colors)
+    {
+        memset(first_, 0, sizeof first_);
+        for (size_t i = 0; i < ruleCount; ++i) {
+            const unsigned char c
+              = static_cast<unsigned char>(rules[i].marker[0]);
+            first_[c] = first_[c | 0x20] = 1;
+            sizes_[i]                    = strlen(rules[i].marker);
+            escapes_[i] = colors ? escape(rules[i].style) : escape();
+        }
+    }
+
+    // Rule matching at p, ruleCount if none; the marker is size long
+    size_t match(const char *p, const char *end, size_t &size) const
+    {
+        for (size_t i = 0; i < ruleCount; ++i) {
+            const size_t n = sizes_[i];
+            if (static_cast<size_t>(end - p) >= n && sameWord(p, i, n)
+                && (p + n == end
+                    || !isWordByte(static_cast<unsigned char>(p[n])))) {
+                size = n;
+                return i;
+            }
+        }
+        return ruleCount;
+    }
+
+    // The marker of the line at line, or null; the rule in index
+    const char *find(const char *line, const char *lineEnd, size_t &index,
+                     size_t &size) const
+    {
+        const char *stop
+          = lineEnd - line > static_cast<ptrdiff_t>(scanWidth)
+          ? line + scanWidth
+          : lineEnd;
+        for (const char *p = line; p != stop; ++p) {
+            if (!first_[static_cast<unsigned char>(*p)]
+                || (p != line
+                    && isWordByte(static_cast<unsigned char>(p[-1])))) {
+                continue;
+            }
+            index = match(p, lineEnd, size);
+            if (index != ruleCount) {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    const escape &style(const size_t index) const { return escapes_[index]; }
+
+private:
+    bool sameWord(const char *p, const size_t index, const size_t n) const
+    {
+        const char *marker = rules[index].marker;
+        for (size_t i = 0; i < n; ++i) {
+            if ((p[i] & ~0x20) != marker[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    unsigned char first_[256];
+    size_t sizes_[ruleCount];
+    escape escapes_[ruleCount];
+};
+
+iovec piece(const char *data, const size_t size)
+{
+    iovec iov;
+    iov.iov_base = const_cast<char *>(data);
+    iov.iov_len  = size;
+    return iov;
+}
+
+/* The pieces of a chunk for writev: runs of the mapped file as they are,
+ * with the escapes around markers in between, so only escapes are new.
+ */
+void colorizeChunk(const severityMatcher &matcher, const char *p,
+                   const char *end, vector<iovec> &pieces)
+{
+    static const char reset[] = "\033[0m";
+    const char *copied        = p;  // start of what isn't in pieces yet
+    while (p != end) {
+        const void *nl = memchr(p, '\n', static_cast<size_t>(end - p));
+        const char *lineEnd = nl != nullptr ? static_cast<const char *>(nl)
+                                            : end;
+        size_t index;
+        size_t size;
+        const char *marker = matcher.find(p, lineEnd, index, size);
+        if (marker != nullptr) {
+            const escape &style = matcher.style(index);
+            pieces.push_back(
+              piece(copied, static_cast<size_t>(marker - copied)));
+            pieces.push_back(piece(style.data(), style.size()));
+            pieces.push_back(piece(marker, size));
+            pieces.push_back(piece(reset, sizeof reset - 1));
+            copied = marker + size;
+        }
+        p = lineEnd == end ? end : lineEnd + 1;
+    }
+    if (copied != end) {
+        pieces.push_back(piece(copied, static_cast<size_t>(end - copied)));
+    }
+}
+
+// Writes all of pieces, which it may change
+bool writeAll(const int fd, iovec *pieces, size_t count)
+{
+#if defined(RANG_OS_LINUX) || defined(RANG_OS_MAC)
+    while (count != 0) {
+        const int batch = static_cast<int>(count < IOV_MAX ? count : IOV_MAX);
+        ssize_t written = writev(fd, pieces, batch);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        // Skips what was written, a piece may be left half done
+        while (count != 0 && static_cast<size_t>(written) >= pieces->iov_len) {
+            written -= static_cast<ssize_t>(pieces->iov_len);
+            ++pieces;
+            --count;
+        }
+        if (count != 0) {
+            pieces->iov_base = static_cast<char *>(pieces->iov_base) + written;
+            pieces->iov_len -= static_cast<size_t>(written);
+        }
+    }
+#else
+    for (; count != 0; ++pieces, --count) {
+        const char *p = static_cast<const char *>(pieces->iov_base);
+        for (size_t left = pieces->iov_len; left != 0;) {
+            const unsigned n = left < (1u << 30) ? static_cast<unsigned>(left)
+                                                 : (1u << 30);
+            const int written = _write(fd, p, n);
+            if (written <= 0) {
+                return false;
+            }
+            p += written;
+            left -= static_cast<size_t>(written);
+        }
+    }
+#endif
+    return true;
+}
+
+/* Colors data to fd. Chunks of about chunkSize bytes, cut at line ends,
+ * are colorized by threads workers and written in order as they are done;
+ * at most a few chunks per worker wait to be written.
+ */
+bool colorize(const char *data, const size_t size, const int fd,
+              const unsigned threads, const bool colors,
+              const size_t chunkSize = 4u << 20)
+{
+    if (!colors || size == 0) {
+        iovec all = piece(data, size);
+        return writeAll(fd, &all, size != 0 ? 1 : 0);
+    }
+
+    vector<const char *> bounds(1, data);
+    const char *end = data + size;
+    while (bounds.back() != end) {
+        const char *at = bounds.back();
+        if (static_cast<size_t>(end - at) <= chunkSize) {
+            bounds.push_back(end);
+            continue;
+        }
+        const void *nl = memchr(at + chunkSize, '\n',
+                                static_cast<size_t>(end - at - chunkSize));
+        bounds.push_back(nl != nullptr ? static_cast<const char *>(nl) + 1
+                                       : end);
+    }
+    const size_t chunks = bounds.size() - 1;
+
+    const severityMatcher matcher(colors);
+    const size_t window = 4 * static_cast<size_t>(threads);
+    // Chunk k uses slot k % window, kept allocated so its pages stay warm
+    vector<vector<iovec>> pieces(window);
+    vector<char> ready(chunks, 0);
+    mutex lock;
+    condition_variable changed;
+    size_t next    = 0;  // chunk to colorize next
+    size_t written = 0;  // chunks written
+
+    const auto work = [&] {
+        unique_lock<mutex> guard(lock);
+        for (;;) {
+            changed.wait(guard, [&] {
+                return next == chunks || next < written + window;
+            });
+            if (next == chunks) {
+                return;
+            }
+            const size_t k = next++;
+            guard.unlock();
+            vector<iovec> &slot = pieces[k % window];
+            slot.clear();
+            colorizeChunk(matcher, bounds[k], bounds[k + 1], slot);
+            guard.lock();
+            ready[k] = 1;
+            changed.notify_all();
+        }
+    };
+    vector<thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+
+    bool ok = true;
+    for (size_t k = 0; k < chunks; ++k) {
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&] { return ready[k] != 0; });
+        }
+        vector<iovec> &slot = pieces[k % window];
+        ok = ok && writeAll(fd, slot.data(), slot.size());
+        lock_guard<mutex> guard(lock);
+        written = k + 1;
+        changed.notify_all();
+    }
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    return ok;
+}
+
+// A log of about megabytes MB in the usual "time level message" format
+bool writeSyntheticLog(const char *path, const size_t megabytes)
+{
+    static const char *const levels[]
+      = { "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR", "INFO", "TRACE" };
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    string block;
+    char line[160];
+    unsigned long long n = 0;
+    for (size_t done = 0; done < megabytes << 20; done += block.size()) {
+        block.clear();
+        while (block.size() < (1u << 20)) {
+            const int length = snprintf(
+              line, sizeof line,
+              "2024-01-01T12:%02llu:%02llu.%03lluZ %-5s worker[%llu] request "
+              "%llu handled in %llums\n",
+              n / 60000 % 60, n / 1000 % 60, n % 1000, levels[n % 8],
+              n % 64, n, n * 7 % 900);
+            block.append(line, static_cast<size_t>(length));
+            ++n;
+        }
+        if (fwrite(block.data(), 1, block.size(), file) != block.size()) {
+            fclose(file);
+            return false;
+        }
+    }
+    return fclose(file) == 0;
+}
+
+/* Colorizes a small log in chunks of a few lines on several threads and
+ * compares the output with what it should be, 0 if it matches
+ */
+int check()
+{
+    static const char log[]
+      = "12:00 INFO started\n"
+        "12:01 warn: disk 91% full\n"
+        "\n"
+        "12:02 [ERROR] write failed, ERROR again\n"
+        "12:03 INFORMATION and XDEBUG are no markers\n"
+        "12:04 Fatal error\n"
+        "12:05 WARNING critical\n"
+        "trace";
+    static const char colored[]
+      = "12:00 \033[32mINFO\033[0m started\n"
+        "12:01 \033[33mwarn\033[0m: disk 91% full\n"
+        "\n"
+        "12:02 [\033[31mERROR\033[0m] write failed, ERROR again\n"
+        "12:03 INFORMATION and XDEBUG are no markers\n"
+        "12:04 \033[31;1mFatal\033[0m error\n"
+        "12:05 \033[33mWARNING\033[0m critical\n"
+        "\033[2mtrace\033[0m";
+    const struct {
+        bool colors;
+        const char *expected;
+        size_t size;
+    } cases[] = { { true, colored, sizeof colored - 1 },
+                  { false, log, sizeof log - 1 } };
+
+    for (const auto &c : cases) {
+        FILE *out = tmpfile();
+        if (out == nullptr) {
+            fputs("logColorizer: cannot create a temporary file\n", stderr);
+            return 1;
+        }
+#if defined(RANG_OS_WIN)
+        const int fd = _fileno(out);
+#else
+        const int fd = fileno(out);
+#endif
+        const bool written
+          = colorize(log, sizeof log - 1, fd, 3, c.colors, 16);
+        string result(c.size + 1, '\0');
+        rewind(out);
+        result.resize(fread(&result[0], 1, result.size(), out));
+        fclose(out);
+        if (!written || result != string(c.expected, c.size)) {
+            fprintf(stderr, "logColorizer: wrong output %s colors:\n%s\n",
+                    c.colors ? "with" : "without", result.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+size_t countLines(const char *p, const size_t size)
+{
+    size_t lines    = 0;
+    const char *end = p + size;
+    while (p != end) {
+        const void *nl = memchr(p, '\n', static_cast<size_t>(end - p));
+        p = nl != nullptr ? static_cast<const char *>(nl) + 1 : end;
+        ++lines;
+    }
+    return lines;
+}
+
+int bench(const size_t megabytes, const unsigned threads)
+{
+    const char *path = "logColorizer.bench.log";
+    if (!writeSyntheticLog(path, megabytes)) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+#if defined(RANG_OS_WIN)
+    const int sink = _open("NUL", _O_WRONLY | _O_BINARY);
+#else
+    const int sink = open("/dev/null", O_WRONLY);
+#endif
+    int status = sink >= 0 ? 0 : 1;
+    {
+        const mappedFile log(path);
+        size_t lines = 0;
+        struct run {
+            const char *name;
+            unsigned threads;
+            bool colors;
+        };
+        // Finding the lines alone is the bound for one thread
+        const run runs[] = { { "lines", 1, false },
+                             { "colored", 1, true },
+                             { "colored", threads, true } };
+        for (const run &r : runs) {
+            if (status != 0 || !log.valid()) {
+                status = 1;
+                break;
+            }
+            const auto start = chrono::steady_clock::now();
+            if (!r.colors) {
+                lines = countLines(log.data(), log.size());
+            } else if (!colorize(log.data(), log.size(), sink, r.threads,
+                                 r.colors)) {
+                status = 1;
+            }
+            const chrono::duration<double> took
+              = chrono::steady_clock::now() - start;
+            printf("%-12s %2u thread%s %6.2f GB/s\n", r.name, r.threads,
+                   r.threads == 1 ? " " : "s",
+                   static_cast<double>(log.size()) / took.count() / 1e9);
+        }
+        printf("%zu lines, %zu MB\n", lines, log.size() >> 20);
+    }
+#if defined(RANG_OS_WIN)
+    _close(sink);
+#else
+    close(sink);
+#endif
+    remove(path);
+    return status;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    rang::init();
+    unsigned threads = thread::hardware_concurrency();
+    threads          = threads != 0 ? threads : 1;
+    const char *path = nullptr;
+    size_t benchSize = 0;
+    bool checking    = false;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg == "--color=always") {
+            setControlMode(control::Force);
+        } else if (arg == "--color=never") {
+            setControlMode(control::Off);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            threads = static_cast<unsigned>(atoi(arg.c_str() + 10));
+            threads = threads != 0 ? threads : 1;
+        } else if (arg.compare(0, 8, "--bench=") == 0) {
+            benchSize = static_cast<size_t>(atol(arg.c_str() + 8));
+        } else if (arg == "--check") {
+            checking = true;
+        } else if (arg != "--color=auto") {
+            path = argv[i];
+        }
+    }
+
+    if (checking) {
+        return check();
+    }
+    if (benchSize != 0) {
+        return bench(benchSize, threads);
+    }
+    if (path == nullptr) {
+        fputs("usage: logColorizer [--color=auto|always|never] "
+              "[--threads=N] file\n"
+              "       logColorizer --check | --bench=MB\n",
+              stderr);
+        return 2;
+    }
+    const mappedFile log(path);
+    if (!log.valid()) {
+        fprintf(stderr, "logColorizer: cannot map %s\n", path);
+        return 1;
+    }
+#if defined(RANG_OS_WIN)
+    _setmode(1, _O_BINARY);
+#endif
+    return colorize(log.data(), log.size(), 1, threads, shouldColorize(1))
+      ? 0
+      : 1;
+}
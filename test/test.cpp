@@ -2,12 +2,59 @@
 #include <doctest/doctest.h>
 
 #include "rang.hpp"
+#include "rang/async.hpp"
+#include "rang/progress.hpp"
+#include "rang/diff.hpp"
+#include "rang/highlight.hpp"
+#include "rang/table.hpp"
+#ifdef RANG_TEST_FMT
+#include <fmt/format.h>
+#endif
+#include "rang/format.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace std;
 using namespace rang;
 
+namespace {
+
+// Records what reaches it and how many calls it took
+class recordingBuf : public streambuf {
+public:
+    string data;
+    int writes = 0;
+
+protected:
+    int_type overflow(const int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            data += traits_type::to_char_type(ch);
+            ++writes;
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    streamsize xsputn(const char *s, const streamsize n) override
+    {
+        data.append(s, static_cast<size_t>(n));
+        ++writes;
+        return n;
+    }
+};
+
+}  // namespace
+
 #if defined(__unix__) || defined(__unix) || defined(__linux__)
 #define OS_LINUX
 #elif defined(WIN32) || defined(_WIN32) || defined(_WIN64)
@@ -18,6 +65,57 @@ using namespace rang;
 #error Unknown Platform
 #endif
 
+#if defined(OS_LINUX) || defined(OS_MAC)
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __GLIBCXX__
+#include <ext/stdio_filebuf.h>
+#endif
+
+namespace {
+
+// Pseudo terminal whose slave side streams can be attached to
+struct pty {
+    int master = -1;
+    const char *name = nullptr;
+
+    pty()
+    {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0) {
+            name = ptsname(master);
+        }
+    }
+
+    ~pty()
+    {
+        if (master >= 0) {
+            close(master);
+        }
+    }
+
+    // Whatever was written to the slave side so far
+    string read()
+    {
+        string out;
+        char buf[256];
+        pollfd p = { master, POLLIN, 0 };
+        while (poll(&p, 1, 100) > 0) {
+            const ssize_t n = ::read(master, buf, sizeof buf);
+            if (n <= 0) {
+                break;
+            }
+            out.append(buf, static_cast<size_t>(n));
+        }
+        return out;
+    }
+};
+
+}  // namespace
+#endif
 
 TEST_CASE("Rang printing with control::Off and cout")
 {
@@ -348,3 +446,1617 @@ TEST_CASE("Rang printing with control::Force and clog")
         REQUIRE(s.size() < output.size());
     }
 }
+
+TEST_CASE("Rang styleSet combines codes into one sequence")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+
+    SUBCASE("Enums combined with operator|")
+    {
+        const styleSet set = fg::red | style::bold | bg::black;
+        ostringstream os;
+        os << set << "Hello" << style::reset;
+
+        REQUIRE(os.str() == "\033[31;1;40mHello\033[0m");
+    }
+
+    SUBCASE("Sets combined with sets and bright colors")
+    {
+        const styleSet base = style::underline | fgB::cyan;
+        ostringstream os;
+        os << (base | bgB::gray);
+
+        REQUIRE(os.str() == "\033[4;96;107m");
+    }
+
+    SUBCASE("Empty set writes nothing")
+    {
+        ostringstream os;
+        os << styleSet() << "Hello";
+
+        REQUIRE(os.str() == "Hello");
+    }
+
+    SUBCASE("Codes beyond capacity are dropped")
+    {
+        styleSet set;
+        for (size_t i = 0; i < styleSet::maxCodes + 4; ++i) {
+            set = set | style::bold;
+        }
+        REQUIRE(set.count() == styleSet::maxCodes);
+    }
+
+    SUBCASE("control::Off writes nothing")
+    {
+        setControlMode(control::Off);
+        ostringstream os;
+        os << (fg::red | style::bold) << "Hello";
+
+        REQUIRE(os.str() == "Hello");
+    }
+}
+
+TEST_CASE("Rang escape sequences generated at compile time")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+
+    SUBCASE("ansiSeq builds the literal")
+    {
+        using alert = ansiSeq<sgrCode(fg::red), sgrCode(style::bold),
+                              sgrCode(bgB::gray)>;
+        static_assert(alert::size == 11, "unexpected sequence length");
+
+        REQUIRE(string(alert::value) == "\033[31;1;107m");
+
+        ostringstream os;
+        os << alert{} << "Hello";
+        REQUIRE(os.str() == "\033[31;1;107mHello");
+    }
+
+#if __cplusplus >= 201703L
+    SUBCASE("seq spells the same sequence")
+    {
+        static_assert(is_same<seq<fg::red, style::bold>,
+                              ansiSeq<31, 1>>::value,
+                      "seq should alias ansiSeq");
+    }
+#endif
+
+    SUBCASE("Enum tables match numeric formatting")
+    {
+        const int codes[] = { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9,
+                              30, 31, 32, 33, 34, 35, 36, 37, 39, 40,
+                              41, 42, 43, 44, 45, 46, 47, 49, 90, 91,
+                              92, 93, 94, 95, 96, 97, 100, 101, 102, 103,
+                              104, 105, 106, 107 };
+        for (const int code : codes) {
+            ostringstream expected;
+            expected << "\033[" << code << "m";
+
+            ostringstream os;
+            if (code < 30) {
+                os << static_cast<style>(code);
+            } else if (code < 40) {
+                os << static_cast<fg>(code);
+            } else if (code < 90) {
+                os << static_cast<bg>(code);
+            } else if (code < 100) {
+                os << static_cast<fgB>(code);
+            } else {
+                os << static_cast<bgB>(code);
+            }
+            REQUIRE(os.str() == expected.str());
+        }
+    }
+}
+
+TEST_CASE("Rang cached stream decision follows setControlMode")
+{
+    setWinTermMode(winTerm::Ansi);
+    ostringstream os;
+
+    setControlMode(control::Force);
+    os << fg::red;
+    REQUIRE(os.str() == "\033[31m");
+
+    setControlMode(control::Off);
+    os << fg::red;
+    REQUIRE(os.str() == "\033[31m");
+
+    setControlMode(control::Force);
+    os << fg::green;
+    REQUIRE(os.str() == "\033[31m\033[32m");
+}
+
+TEST_CASE("Rang 24-bit and 256 color palette")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+
+    SUBCASE("Foreground and background encodings")
+    {
+        ostringstream os;
+        os << fgRgb(255, 128, 0) << bgRgb(0, 7, 42) << fg256(208)
+           << bg256(7);
+
+        REQUIRE(os.str()
+                == "\033[38;2;255;128;0m\033[48;2;0;7;42m\033[38;5;208m"
+                   "\033[48;5;7m");
+    }
+
+    SUBCASE("Combined into a styleSet")
+    {
+        ostringstream os;
+        os << (style::bold | fgRgb(1, 2, 3) | bg256(255));
+
+        REQUIRE(os.str() == "\033[1;38;2;1;2;3;48;5;255m");
+    }
+
+    SUBCASE("A styleSet never keeps half of an extended color")
+    {
+        styleSet set = fgRgb(1, 1, 1) | bgRgb(2, 2, 2) | fgRgb(3, 3, 3);
+        set          = set | bgRgb(4, 4, 4);
+
+        REQUIRE(set.count() == 15);
+        REQUIRE(string(set.data())
+                == "\033[38;2;1;1;1;48;2;2;2;2;38;2;3;3;3m");
+    }
+
+    SUBCASE("control::Off writes nothing")
+    {
+        setControlMode(control::Off);
+        ostringstream os;
+        os << fgRgb(255, 0, 0) << bg256(1) << "Hello";
+
+        REQUIRE(os.str() == "Hello");
+    }
+}
+
+TEST_CASE("Rang extended colors follow the terminal color level")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+
+    SUBCASE("Ansi256 keeps palette colors and maps 24-bit ones")
+    {
+        setColorLevel(colorLevel::Ansi256);
+        ostringstream os;
+        os << fg256(42) << fgRgb(255, 0, 0) << bgRgb(128, 128, 128)
+           << fgRgb(0, 95, 135);
+
+        REQUIRE(os.str()
+                == "\033[38;5;42m\033[38;5;196m\033[48;5;244m"
+                   "\033[38;5;24m");
+    }
+
+    SUBCASE("Ansi16 maps to the basic colors")
+    {
+        setColorLevel(colorLevel::Ansi16);
+        ostringstream os;
+        os << fgRgb(255, 0, 0) << bg256(4) << bgRgb(0, 0, 0) << fg256(15);
+
+        REQUIRE(os.str() == "\033[91m\033[44m\033[40m\033[97m");
+    }
+
+    SUBCASE("styleSet is downsampled when written")
+    {
+        const styleSet set = style::bold | fgRgb(255, 255, 0) | bg256(196);
+
+        setColorLevel(colorLevel::Ansi16);
+        ostringstream basic;
+        basic << set;
+        REQUIRE(basic.str() == "\033[1;93;101m");
+
+        setColorLevel(colorLevel::TrueColor);
+        ostringstream full;
+        full << set;
+        REQUIRE(full.str() == "\033[1;38;2;255;255;0;48;5;196m");
+    }
+
+    SUBCASE("No colors in Auto mode without color support")
+    {
+        setControlMode(control::Auto);
+        setColorLevel(colorLevel::None);
+        ostringstream os;
+        os << fg::red << "Hello";
+
+        REQUIRE(os.str() == "Hello");
+    }
+
+    setColorLevel(colorLevel::TrueColor);
+}
+
+TEST_CASE("Rang colorbuf coalesces writes")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+    recordingBuf target;
+
+    SUBCASE("A colored line reaches the target in one write")
+    {
+        colorbuf buf(&target);
+        ostream os(&buf);
+        os << fg::red << "failed" << style::reset << ": " << 42;
+        REQUIRE(target.writes == 0);
+
+        os << '\n';
+        REQUIRE(target.writes == 1);
+        REQUIRE(target.data == "\033[31mfailed\033[0m: 42\n");
+    }
+
+    SUBCASE("Without line buffering only flush and capacity write")
+    {
+        colorbuf buf(&target, 8, false);
+        ostream os(&buf);
+        os << "abc\n";
+        REQUIRE(target.writes == 0);
+
+        os << "defgh";
+        REQUIRE(target.data == "abc\n");
+
+        os << flush;
+        REQUIRE(target.data == "abc\ndefgh");
+    }
+
+    SUBCASE("Large writes go straight through")
+    {
+        colorbuf buf(&target, 4);
+        ostream os(&buf);
+        os << "ab" << "0123456789";
+
+        REQUIRE(target.data == "ab0123456789");
+        REQUIRE(target.writes == 2);
+    }
+
+    SUBCASE("Unbuffered colorbuf and destructor flush")
+    {
+        {
+            colorbuf buf(&target, 0);
+            ostream os(&buf);
+            os.put('x');
+            REQUIRE(target.data == "x");
+        }
+        {
+            colorbuf buf(&target);
+            ostream os(&buf);
+            os << "yz";
+        }
+        REQUIRE(target.data == "xyz");
+    }
+}
+
+TEST_CASE("Rang state tracking skips redundant escapes")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+    ostringstream os;
+    setStateTracking(os, true);
+
+    SUBCASE("Repeated attributes and idle resets write nothing")
+    {
+        os << style::reset << fg::red << "a" << fg::red << style::bold
+           << style::bold << "b" << fg::reset << fg::reset;
+
+        REQUIRE(os.str() == "\033[31ma\033[1mb\033[39m");
+    }
+
+    SUBCASE("A styleSet writes only the difference")
+    {
+        os << fg::red << (fg::red | style::bold | bg::blue) << "x"
+           << (style::bold | fgRgb(1, 2, 3) | bg::blue);
+
+        REQUIRE(os.str() == "\033[31m\033[1;44mx\033[38;2;1;2;3m");
+    }
+
+    SUBCASE("Dropping a style goes through reset")
+    {
+        os << (style::bold | style::underline | fg::green) << "x"
+           << style::reset << (style::bold | fg::green) << "y";
+
+        REQUIRE(os.str() == "\033[1;4;32mx\033[0m\033[1;32my");
+    }
+
+    SUBCASE("Disabled tracking writes everything again")
+    {
+        os << fg::red;
+        setStateTracking(os, false);
+        os << fg::red;
+
+        REQUIRE(os.str() == "\033[31m\033[31m");
+    }
+
+    SUBCASE("copyfmt gives the copy its own state")
+    {
+        ostringstream other;
+        other.copyfmt(os);
+        os << fg::red;
+        other << fg::red << fg::red;
+
+        REQUIRE(os.str() == "\033[31m");
+        REQUIRE(other.str() == "\033[31m");
+    }
+}
+
+TEST_CASE("Rang stripbuf removes escapes")
+{
+    ostringstream target;
+
+    SUBCASE("Off strips CSI and two byte escapes")
+    {
+        stripbuf buf(target.rdbuf(), control::Off);
+        ostream os(&buf);
+        os << "\033[1;31mred\033[0m plain \033cdone\033[2K" << '!';
+
+        REQUIRE(target.str() == "red plain done!");
+    }
+
+    SUBCASE("Sequences split across writes")
+    {
+        stripbuf buf(target.rdbuf(), control::Off);
+        ostream os(&buf);
+        os << "a\033" << "[38;2;" << '1' << "mb\033" << 'M' << "c";
+
+        REQUIRE(target.str() == "abc");
+    }
+
+    SUBCASE("Force passes everything through")
+    {
+        stripbuf buf(target.rdbuf(), control::Force);
+        ostream os(&buf);
+        os << "\033[31mx";
+
+        REQUIRE(target.str() == "\033[31mx");
+    }
+
+    SUBCASE("Auto follows the control mode")
+    {
+        setControlMode(control::Force);
+        stripbuf buf(target.rdbuf());
+        ostream os(&buf);
+        os << "\033[31mx" << fg::blue;
+        setControlMode(control::Off);
+        os << "\033[31my" << fg::blue;
+        setControlMode(control::Auto);
+        os << "\033[31mz";
+        setControlMode(control::Force);
+
+        REQUIRE(target.str() == "\033[31mx\033[34myz");
+    }
+}
+
+TEST_CASE("Rang per-stream control mode")
+{
+    setControlMode(control::Off);
+    setWinTermMode(winTerm::Ansi);
+    ostringstream forced, other;
+
+    SUBCASE("Override takes precedence over the global mode")
+    {
+        setControlMode(forced, control::Force);
+        forced << fg::red << "x";
+        other << fg::red << "x";
+
+        REQUIRE(forced.str() == "\033[31mx");
+        REQUIRE(other.str() == "x");
+    }
+
+    SUBCASE("Global changes don't reach overridden streams")
+    {
+        setControlMode(forced, control::Off);
+        setControlMode(control::Force);
+        forced << fg::red << "x";
+        other << fg::red << "x";
+        clearStreamModes(forced);
+        forced << fg::blue;
+
+        REQUIRE(forced.str() == "x\033[34m");
+        REQUIRE(other.str() == "\033[31mx");
+    }
+
+    SUBCASE("Scopes restore the previous override")
+    {
+        setControlMode(forced, control::Force);
+        {
+            controlScope plain(forced, control::Off);
+            forced << fg::red << "x";
+            {
+                controlScope colored(forced, control::Force);
+                forced << fg::green;
+            }
+            forced << fg::red;
+        }
+        forced << fg::blue;
+        {
+            controlScope plain(other, control::Force);
+            other << fg::red;
+        }
+        other << fg::red;
+
+        REQUIRE(forced.str() == "x\033[32m\033[34m");
+        REQUIRE(other.str() == "\033[31m");
+    }
+
+    setControlMode(control::Force);
+}
+
+#if defined(OS_LINUX) || defined(OS_MAC)
+TEST_CASE("Rang terminal detection beyond cout and cerr")
+{
+    setControlMode(control::Auto);
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+    pty term;
+    REQUIRE(term.name != nullptr);
+
+    SUBCASE("Registered streambufs follow their fd")
+    {
+        const int slave = open(term.name, O_RDWR | O_NOCTTY);
+        const int null  = open("/dev/null", O_WRONLY);
+        ostringstream colored, plain;
+        colored << fg::red;
+        REQUIRE(registerTerminal(colored.rdbuf(), slave));
+        REQUIRE(registerTerminal(plain.rdbuf(), null));
+        colored << fg::blue;
+        plain << fg::blue;
+        unregisterTerminal(colored.rdbuf());
+        unregisterTerminal(plain.rdbuf());
+        colored << fg::green;
+        close(slave);
+        close(null);
+
+        REQUIRE(colored.str() == "\033[34m");
+        REQUIRE(plain.str() == "");
+    }
+
+#ifdef __GLIBCXX__
+    SUBCASE("ofstream on a terminal")
+    {
+        ofstream tty(term.name);
+        tty << fg::red << "x" << flush;
+
+        REQUIRE(term.read() == "\033[31mx");
+    }
+
+    SUBCASE("ofstream on a regular file")
+    {
+        const string fileName = "rang_registry.txt";
+        ofstream out(fileName);
+        out << fg::red << "x";
+
+        REQUIRE(out.tellp() == 1);
+        out.close();
+        remove(fileName.c_str());
+    }
+
+    SUBCASE("stdio_filebuf wrapping a terminal fd")
+    {
+        const int slave = open(term.name, O_RDWR | O_NOCTTY);
+        __gnu_cxx::stdio_filebuf<char> buf(slave, ios::out);
+        ostream os(&buf);
+        os << fg::red << "x" << flush;
+
+        REQUIRE(term.read() == "\033[31mx");
+    }
+#endif
+
+    setControlMode(control::Force);
+}
+#endif
+
+TEST_CASE("Rang line writes whole lines")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+
+    SUBCASE("One write per line")
+    {
+        recordingBuf buf;
+        ostream os(&buf);
+        line(os) << fg::red << "code " << 42 << style::reset << '\n';
+
+        REQUIRE(buf.data == "\033[31mcode 42\033[0m\n");
+        REQUIRE(buf.writes == 1);
+    }
+
+    SUBCASE("Colors follow the target stream")
+    {
+        ostringstream os;
+        setControlMode(os, control::Off);
+        line(os) << fg::red << "plain" << style::reset << "\033[1m!";
+
+        REQUIRE(os.str() == "plain!");
+    }
+
+    SUBCASE("Lines built while building a line")
+    {
+        ostringstream outer, inner;
+        line(outer) << "a" << [&inner] {
+            line(inner) << fg::green << "b";
+            return "c";
+        }() << fg::blue;
+
+        REQUIRE(outer.str() == "ac\033[34m");
+        REQUIRE(inner.str() == "\033[32mb");
+    }
+
+    SUBCASE("Manipulators end with the line")
+    {
+        ostringstream os;
+        line(os) << std::hex << std::setw(4) << std::setfill('0')
+                 << std::setprecision(2) << 255 << ' ' << 1.23456 << '\n';
+        line(os) << 255 << ' ' << 1.23456 << '\n';
+
+        REQUIRE(os.str() == "00ff 1.2\n255 1.23456\n");
+    }
+}
+
+TEST_CASE("Rang line stress test with many threads")
+{
+    setControlMode(control::Force);
+    setWinTermMode(winTerm::Ansi);
+    const fg colors[] = { fg::red, fg::green, fg::yellow, fg::blue };
+    const int threadCount = 8;
+    const int lineCount   = 2000;
+
+    ostringstream os;
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&os, &colors, t] {
+            for (int i = 0; i < lineCount; ++i) {
+                line(os) << colors[t % 4] << "thread " << t << " line " << i
+                         << style::reset << '\n';
+            }
+        });
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+
+    istringstream in(os.str());
+    string text;
+    vector<int> next(threadCount, 0);
+    int lines = 0;
+    while (getline(in, text)) {
+        int t = -1, i = -1, color = -1;
+        char rest = 0;
+        const int fields
+          = sscanf(text.c_str(), "\033[%dmthread %d line %d\033[0%c", &color,
+                   &t, &i, &rest);
+        REQUIRE(fields == 4);
+        REQUIRE(rest == 'm');
+        REQUIRE(t >= 0);
+        REQUIRE(t < threadCount);
+        REQUIRE(color == static_cast<int>(colors[t % 4]));
+        REQUIRE(i == next[t]++);
+        REQUIRE(count(text.begin(), text.end(), '\033') == 2);
+        ++lines;
+    }
+    REQUIRE(lines == threadCount * lineCount);
+}
+
+namespace {
+
+// Holds the writer thread of an asyncSink in its first write until opened
+class gateBuf : public recordingBuf {
+public:
+    void open()
+    {
+        lock_guard<mutex> lock(m);
+        opened = true;
+        cv.notify_all();
+    }
+
+protected:
+    streamsize xsputn(const char *s, const streamsize n) override
+    {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this] { return opened; });
+        return recordingBuf::xsputn(s, n);
+    }
+
+private:
+    mutex m;
+    condition_variable cv;
+    bool opened = false;
+};
+
+}  // namespace
+
+TEST_CASE("Rang asyncSink")
+{
+    setColorLevel(colorLevel::TrueColor);
+    setWinTermMode(winTerm::Ansi);
+
+    SUBCASE("Records are written in order with their style")
+    {
+        ostringstream os;
+        setControlMode(os, control::Force);
+        {
+            asyncSink sink(os);
+            sink.write(fg::red | style::bold, "failed\n");
+            sink.write(styleSet(), string("plain "));
+            sink.write(fgRgb(1, 2, 3), "rgb");
+        }
+
+        REQUIRE(os.str()
+                == "\033[31;1mfailed\033[0m\nplain \033[38;2;1;2;3mrgb\033[0m");
+    }
+
+    SUBCASE("Colors follow the target stream")
+    {
+        ostringstream os;
+        setControlMode(os, control::Off);
+        asyncSink sink(os);
+        sink.write(fg::red, "a");
+        sink.write(bg::blue, "b");
+        sink.flush();
+
+        REQUIRE(os.str() == "ab");
+    }
+
+    SUBCASE("Rings of exited threads and closed sinks are freed")
+    {
+        ostringstream os;
+        setControlMode(os, control::Off);
+        asyncSink sink(os);
+        for (int i = 0; i < 20; ++i) {
+            thread([&sink] { sink.write(styleSet(), "t"); }).join();
+        }
+        sink.write(styleSet(), "m");
+        sink.flush();
+        REQUIRE(os.str() == string(20, 't') + "m");
+        REQUIRE(sink.rings() == 1);  // this thread's
+
+        for (int i = 0; i < 20; ++i) {
+            ostringstream other;
+            asyncSink task(other);
+            task.write(styleSet(), "x");
+        }
+        sink.write(styleSet(), "m");
+        REQUIRE(rang_implementation::threadRings().size() <= 2);
+    }
+
+    SUBCASE("Large records are split")
+    {
+        ostringstream os;
+        setControlMode(os, control::Off);
+        const string text(5000, 'x');
+        {
+            asyncSink sink(os, 1024);
+            REQUIRE(sink.write(fg::red, text));
+        }
+
+        REQUIRE(os.str() == text);
+    }
+
+    SUBCASE("Every policy keeps per thread order")
+    {
+        const backpressure policies[] = { backpressure::Block,
+                                          backpressure::Drop,
+                                          backpressure::Overwrite };
+        for (const backpressure policy : policies) {
+            ostringstream os;
+            setControlMode(os, control::Off);
+            const int threadCount = 4;
+            const int recordCount = 5000;
+            uint64_t dropped      = 0;
+            {
+                asyncSink sink(os, 1024, policy);
+                vector<thread> threads;
+                for (int t = 0; t < threadCount; ++t) {
+                    threads.emplace_back([&sink, t] {
+                        for (int i = 0; i < recordCount; ++i) {
+                            sink.write(fg::green, to_string(t) + ' '
+                                         + to_string(i) + '\n');
+                        }
+                    });
+                }
+                for (thread &t : threads) {
+                    t.join();
+                }
+                dropped = sink.dropped();
+            }
+
+            istringstream in(os.str());
+            vector<int> last(threadCount, -1);
+            int t = 0, i = 0;
+            uint64_t records = 0;
+            while (in >> t >> i) {
+                REQUIRE(i > last[t]);
+                last[t] = i;
+                ++records;
+            }
+            REQUIRE(records + dropped == threadCount * recordCount);
+            if (policy == backpressure::Block) {
+                REQUIRE(dropped == 0);
+            }
+        }
+    }
+
+    SUBCASE("Drop and Overwrite when the writer is stuck")
+    {
+        gateBuf dropBuf, overwriteBuf;
+        ostream dropOs(&dropBuf), overwriteOs(&overwriteBuf);
+        setControlMode(dropOs, control::Off);
+        setControlMode(overwriteOs, control::Off);
+        {
+            asyncSink drop(dropOs, 1024, backpressure::Drop);
+            asyncSink overwrite(overwriteOs, 1024, backpressure::Overwrite);
+            // The writers take the first record and wait in the gate
+            drop.write(styleSet(), "first ");
+            overwrite.write(styleSet(), "first ");
+            this_thread::sleep_for(chrono::milliseconds(50));
+            for (int i = 0; i < 1000; ++i) {
+                const string text = "record " + to_string(i) + ' ';
+                drop.write(styleSet(), text);
+                overwrite.write(styleSet(), text);
+            }
+
+            REQUIRE(drop.dropped() > 0);
+            REQUIRE(overwrite.dropped() > 0);
+            dropBuf.open();
+            overwriteBuf.open();
+        }
+
+        REQUIRE(dropBuf.data.find("record 0 ") != string::npos);
+        REQUIRE(dropBuf.data.find("record 999 ") == string::npos);
+        REQUIRE(overwriteBuf.data.find("record 0 ") == string::npos);
+        REQUIRE(overwriteBuf.data.find("record 999 ") != string::npos);
+    }
+}
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304L
+TEST_CASE("Rang markup templates")
+{
+    setWinTermMode(winTerm::Ansi);
+    constexpr auto failed = markup("<red,bold>ERROR</>: {} ({})\n");
+    static_assert(failed.args() == 2, "two placeholders");
+
+    SUBCASE("Tags become escapes, arguments are inserted")
+    {
+        ostringstream os;
+        setControlMode(os, control::Force);
+        os << failed("disk full", 28);
+
+        REQUIRE(os.str() == "\033[31;1mERROR\033[0m: disk full (28)\n");
+    }
+
+    SUBCASE("Streams without colors get the plain text")
+    {
+        ostringstream os;
+        setControlMode(os, control::Off);
+        os << failed("disk full", 28);
+
+        REQUIRE(os.str() == "ERROR: disk full (28)\n");
+    }
+
+    SUBCASE("Prefixed names, merged tags and literal characters")
+    {
+        constexpr auto text
+          = markup("<fgB:red><bg:blue>{{<<x>}}</><bgB:cyan,fg:reset>.");
+        ostringstream os;
+        setControlMode(os, control::Force);
+        os << text();
+
+        REQUIRE(os.str() == "\033[91;44m{<x>}\033[0;106;39m.");
+    }
+
+    SUBCASE("Checked templates and calls kept for later")
+    {
+        const auto &checked = RANG_MARKUP("<green>{}</> of {}");
+        const int done      = 3;
+        const auto call     = RANG_MARKUP("[{}]")(done);
+        ostringstream os;
+        setControlMode(os, control::Force);
+        os << checked(done, 4) << call;
+
+        REQUIRE(os.str() == "\033[32m3\033[0m of 4[3]");
+    }
+
+    SUBCASE("Calls with the wrong number of arguments throw")
+    {
+        ostringstream os;
+        REQUIRE_THROWS_AS(os << failed("a"), invalid_argument);
+        REQUIRE_THROWS_AS(os << failed(1, 2, 3), invalid_argument);
+        REQUIRE(os.str().empty());
+    }
+
+    SUBCASE("Bad markup throws when not constexpr")
+    {
+        REQUIRE_THROWS_AS(markup("<bold,redd>x"), invalid_argument);
+        REQUIRE_THROWS_AS(markup("<bold"), invalid_argument);
+        REQUIRE_THROWS_AS(markup("x}"), invalid_argument);
+    }
+}
+#endif
+
+#ifdef RANG_TEST_FMT
+TEST_CASE("Rang formatters for fmt")
+{
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+
+    SUBCASE("Attributes and styled values get escapes when colorizing")
+    {
+        formatScope colors(control::Force);
+        const string out = fmt::format("{}x{}|{:>6.2f}|{}", fg::red,
+                                       style::reset, styled(3.14159, fg::green),
+                                       styled("ok", fg::blue | style::bold));
+
+        REQUIRE(out
+                == "\033[31mx\033[0m|\033[32m  3.14\033[0m"
+                   "|\033[34;1mok\033[0m");
+    }
+
+    SUBCASE("Styled values outlive their arguments")
+    {
+        formatScope colors(control::Force);
+        const auto name = styled(string("temporary"), fg::red);
+
+        REQUIRE(fmt::format("{:>10}", name) == "\033[31m temporary\033[0m");
+    }
+
+    SUBCASE("Only the formatted text otherwise")
+    {
+        formatScope colors(control::Off);
+        const string out = fmt::format("{}x{}|{:>6.2f}", fg::red, style::reset,
+                                       styled(3.14159, fg::green));
+
+        REQUIRE(out == "x|  3.14");
+    }
+
+    SUBCASE("Extended colors are downsampled")
+    {
+        formatScope colors(control::Force);
+        setColorLevel(colorLevel::Ansi16);
+        char buf[32];
+        const auto end = fmt::format_to(buf, "{}", fgRgb(250, 10, 10));
+        setColorLevel(colorLevel::TrueColor);
+
+        REQUIRE(string(buf, end) == "\033[91m");
+    }
+
+    SUBCASE("Scopes nest and restore")
+    {
+        formatScope off(control::Off);
+        {
+            formatScope on(control::Force);
+            REQUIRE(fmt::format("{}", bg::blue) == "\033[44m");
+        }
+        REQUIRE(fmt::format("{}", bg::blue) == "");
+    }
+
+    SUBCASE("Attributes reject format specs")
+    {
+        char buf[8];
+        REQUIRE_THROWS_AS(fmt::format_to(buf, fmt::runtime("{:>4}"), fg::red),
+                          fmt::format_error);
+    }
+}
+#endif
+
+#if defined(__cpp_lib_format)
+TEST_CASE("Rang formatters for std::format")
+{
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+
+    SUBCASE("Attributes and styled values get escapes when colorizing")
+    {
+        formatScope colors(control::Force);
+        const string out = std::format("{}x{}|{:>6.2f}|{}", fg::red,
+                                       style::reset, styled(3.14159, fg::green),
+                                       styled("ok", fg::blue | style::bold));
+
+        REQUIRE(out
+                == "\033[31mx\033[0m|\033[32m  3.14\033[0m"
+                   "|\033[34;1mok\033[0m");
+    }
+
+    SUBCASE("Only the formatted text otherwise")
+    {
+        formatScope colors(control::Off);
+        REQUIRE(std::format("{}x{}|{:>4}", fg::red, style::reset,
+                            styled(string("ab"), fg::green))
+                == "x|  ab");
+    }
+
+    SUBCASE("Attributes reject format specs")
+    {
+        fg red = fg::red;
+        REQUIRE_THROWS_AS(
+          (void)std::vformat("{:>4}", std::make_format_args(red)),
+          std::format_error);
+    }
+}
+#endif
+
+#if defined(OS_LINUX) || defined(OS_MAC)
+TEST_CASE("Rang decision for file descriptors")
+{
+    setWinTermMode(winTerm::Ansi);
+    const int null = open("/dev/null", O_WRONLY);
+
+    setControlMode(control::Off);
+    REQUIRE_FALSE(shouldColorize(1));
+    setControlMode(control::Force);
+    REQUIRE(shouldColorize(1));
+    REQUIRE(shouldColorize(null));
+    setControlMode(control::Auto);
+    REQUIRE_FALSE(shouldColorize(null));
+
+#ifdef RANG_TEST_FMT
+    formatScope likeNull(null);
+    REQUIRE(fmt::format("{}", fg::red) == "");
+#endif
+    close(null);
+}
+#endif
+
+#if defined(OS_LINUX) || defined(OS_MAC)
+TEST_CASE("Rang output without iostreams")
+{
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    const auto drain = [&]() {
+        char buf[256];
+        const ssize_t n = read(fds[0], buf, sizeof buf);
+        return n > 0 ? string(buf, static_cast<size_t>(n)) : string();
+    };
+
+    SUBCASE("Escapes into a char buffer")
+    {
+        char buf[8];
+        REQUIRE(escapeTo(buf, sizeof buf, fg::red | style::bold) == 7);
+        REQUIRE(string(buf, 7) == "\033[31;1m");
+        REQUIRE(escapeTo(buf, 4, fg::red | style::bold) == 7);
+
+        setColorLevel(colorLevel::Ansi256);
+        const escape seq(fgRgb(255, 0, 0));
+        setColorLevel(colorLevel::TrueColor);
+        REQUIRE(string(seq.data(), seq.size()) == "\033[38;5;196m");
+    }
+
+    SUBCASE("fd and FILE* follow the control mode")
+    {
+        setControlMode(control::Force);
+        REQUIRE(writeStyle(fds[1], fg::green));
+        REQUIRE(writeStyled(fds[1], bg::blue, "x", 1) == 10);
+        REQUIRE(drain() == "\033[32m\033[44mx\033[0m");
+
+        FILE *file = fdopen(dup(fds[1]), "w");
+        REQUIRE(fputStyle(style::bold, file) >= 0);
+        fclose(file);
+        REQUIRE(drain() == "\033[1m");
+
+        setControlMode(control::Auto);
+        REQUIRE(writeStyle(fds[1], fg::green));
+        REQUIRE(writeStyled(fds[1], bg::blue, "x", 1) == 1);
+        REQUIRE(drain() == "x");
+    }
+
+    SUBCASE("Pieces for writev")
+    {
+        const escape none(fg::red, fds[1]);
+        iovec iov[3];
+        REQUIRE(styledIovec(iov, none, "ab", 2) == 1);
+        REQUIRE(iov[0].iov_len == 2);
+
+        const escape red(fg::red);
+        REQUIRE(styledIovec(iov, red, "ab", 2) == 3);
+        REQUIRE(writev(fds[1], iov, 3) == 11);
+        REQUIRE(drain() == "\033[31mab\033[0m");
+    }
+
+    SUBCASE("Writes resume after signals")
+    {
+        // A full pipe blocks the write until the signal has come
+        const int flags = fcntl(fds[1], F_GETFL);
+        fcntl(fds[1], F_SETFL, flags | O_NONBLOCK);
+        const string block(4096, 'x');
+        size_t queued = 0;
+        for (ssize_t n; (n = write(fds[1], block.data(), block.size())) > 0;) {
+            queued += static_cast<size_t>(n);
+        }
+        fcntl(fds[1], F_SETFL, flags);
+
+        static volatile sig_atomic_t signals = 0;
+        struct sigaction action, saved;
+        memset(&action, 0, sizeof action);
+        action.sa_handler = [](int) { signals = 1; };  // no SA_RESTART
+        sigaction(SIGUSR1, &action, &saved);
+
+        const pthread_t writer = pthread_self();
+        size_t drained         = 0;
+        thread reader([&] {
+            this_thread::sleep_for(chrono::milliseconds(50));
+            pthread_kill(writer, SIGUSR1);
+            this_thread::sleep_for(chrono::milliseconds(50));
+            char buf[4096];
+            pollfd p = { fds[0], POLLIN, 0 };
+            while (drained < queued + 5 && poll(&p, 1, 1000) > 0) {
+                const ssize_t n = read(fds[0], buf, sizeof buf);
+                drained += n > 0 ? static_cast<size_t>(n) : 0;
+            }
+        });
+        setControlMode(control::Force);
+        const bool written = writeStyle(fds[1], fg::green);
+        reader.join();
+        sigaction(SIGUSR1, &saved, nullptr);
+
+        REQUIRE(signals == 1);
+        REQUIRE(written);
+        REQUIRE(drained == queued + 5);
+    }
+
+    SUBCASE("Terminals get colors in Auto mode")
+    {
+        pty term;
+        REQUIRE(term.name != nullptr);
+        const int slave = open(term.name, O_RDWR | O_NOCTTY);
+        REQUIRE(writeStyled(slave, fg::red, "t", 1) == 10);
+        close(slave);
+        REQUIRE(term.read().find("\033[31mt\033[0m") != string::npos);
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    setControlMode(control::Auto);
+}
+#endif
+
+#if defined(OS_LINUX) || defined(OS_MAC)
+TEST_CASE("Rang init from the parent's environment")
+{
+    setControlMode(control::Auto);
+    const environment probed = probeEnvironment();
+    char value[5];
+
+    SUBCASE("The variable is parsed strictly")
+    {
+        environment env;
+        REQUIRE(parseEnvironment("2011", env));
+        REQUIRE(env.level == colorLevel::Ansi256);
+        REQUIRE_FALSE(env.terminal[0]);
+        REQUIRE(env.terminal[1]);
+        REQUIRE(env.terminal[2]);
+        formatEnvironment(env, value);
+        REQUIRE(string(value) == "2011");
+
+        REQUIRE_FALSE(parseEnvironment("4011", env));
+        REQUIRE_FALSE(parseEnvironment("201", env));
+        REQUIRE_FALSE(parseEnvironment("20111", env));
+        REQUIRE_FALSE(parseEnvironment("2x11", env));
+    }
+
+    SUBCASE("Inherited values replace probing and are consumed")
+    {
+        REQUIRE(setenv("RANG_ENVIRONMENT", "1011", 1) == 0);
+        const environment env = init();
+        REQUIRE(getenv("RANG_ENVIRONMENT") == nullptr);
+        REQUIRE(env.level == colorLevel::Ansi16);
+        REQUIRE(shouldColorize(1));
+        REQUIRE(rang_implementation::shouldColorize(std::cout));
+
+        const escape seq(fgRgb(255, 0, 0));
+        REQUIRE(string(seq.data(), seq.size()).find("38;") == string::npos);
+    }
+
+    SUBCASE("Malformed values fall back to probing")
+    {
+        REQUIRE(setenv("RANG_ENVIRONMENT", "oops", 1) == 0);
+        initOptions options;
+        options.consume = false;
+        const environment env = init(options);
+        REQUIRE(getenv("RANG_ENVIRONMENT") != nullptr);
+        REQUIRE(env.level == probed.level);
+        REQUIRE(env.terminal[1] == probed.terminal[1]);
+        unsetenv("RANG_ENVIRONMENT");
+    }
+
+    // Back to what this process really has, for the other tests
+    REQUIRE(exportEnvironment(probed));
+    init();
+}
+#endif
+
+TEST_CASE("Rang progress bars")
+{
+    const auto never = chrono::milliseconds(3600 * 1000);
+    setControlMode(control::Auto);
+
+    SUBCASE("Plain lines when not on a terminal")
+    {
+        ostringstream out;
+        {
+            progressBoard board(out, never, never, 4);
+            REQUIRE_FALSE(board.terminal());
+            progressBar &files = board.add("files", 4);
+            progressBar &spin  = board.add("scan", 0);
+            files.add(2);
+            board.refresh();
+            REQUIRE(out.str() == "files [##--]  50% 2/4\n");
+
+            board.refresh();
+            REQUIRE(out.str() == "files [##--]  50% 2/4\n");
+
+            spin.add();
+            spin.finish();
+        }
+        REQUIRE(out.str() == "files [##--]  50% 2/4\nscan * 1\n");
+    }
+
+    SUBCASE("Counted from many threads")
+    {
+        ostringstream out;
+        progressBoard board(out, chrono::milliseconds(1), never, 4);
+        progressBar &work = board.add("work", 4000);
+        vector<thread> workers;
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&work] {
+                for (int i = 0; i < 1000; ++i) {
+                    work.add();
+                }
+            });
+        }
+        for (thread &worker : workers) {
+            worker.join();
+        }
+        board.refresh();
+        REQUIRE(work.done() == 4000);
+        REQUIRE(out.str() == "work [####] 100% 4000/4000\n");
+    }
+
+#if defined(OS_LINUX) || defined(OS_MAC)
+    SUBCASE("Only changed cells are rewritten on a terminal")
+    {
+        setWinTermMode(winTerm::Ansi);
+        setColorLevel(colorLevel::TrueColor);
+        pty term;
+        REQUIRE(term.name != nullptr);
+        const int slave = open(term.name, O_RDWR | O_NOCTTY);
+        ostringstream out;
+        REQUIRE(registerTerminal(out.rdbuf(), slave));
+        {
+            progressBoard board(out, never, never, 4);
+            REQUIRE(board.terminal());
+            progressBar &a = board.add("a", 4, fg::red);
+            board.add("b", 4, fg::blue);
+            board.refresh();
+            REQUIRE(out.str()
+                    == "a [\033[2m----\033[0m]   0% 0/4\n"
+                       "b [\033[2m----\033[0m]   0% 0/4\n");
+
+            out.str("");
+            a.add();
+            board.refresh();
+            REQUIRE(out.str()
+                    == "\033[2A\r\033[3C\033[31m#\033[0m\033[6C25% 1\033[2B\r");
+        }
+        unregisterTerminal(out.rdbuf());
+        close(slave);
+    }
+#endif
+}
+
+TEST_CASE("Rang cursor, erase and screen control")
+{
+    setWinTermMode(winTerm::Ansi);
+
+    SUBCASE("Written like colors")
+    {
+        ostringstream out;
+        setControlMode(control::Force);
+        out << cursorUp(2) << cursorTo(3, 7) << erase::line << cursor::hide
+            << screen::alternate << scrollRegion(2, 20) << scrollRegion()
+            << cursorForward(0) << cursor::save;
+        REQUIRE(out.str()
+                == "\033[2A\033[3;7H\033[2K\033[?25l\033[?1049h\033[2;20r"
+                   "\033[r\0337");
+
+        ostringstream off;
+        setControlMode(control::Off);
+        off << cursorDown(1) << erase::screen << "x";
+        REQUIRE(off.str() == "x");
+        setControlMode(control::Auto);
+    }
+
+    SUBCASE("Encoded on the stack")
+    {
+        char buf[24];
+        REQUIRE(escapeTo(buf, sizeof buf, cursorColumn(4294967295u)) == 13);
+        REQUIRE(string(buf, 13) == "\033[4294967295G");
+        REQUIRE(escapeTo(buf, 2, erase::lineEnd) == 3);
+        REQUIRE(escapeTo(buf, sizeof buf, scrollUp(0)) == 0);
+    }
+
+    SUBCASE("Stripped like colors")
+    {
+        ostringstream out;
+        stripbuf strip(out.rdbuf(), control::Off);
+        ostream os(&strip);
+        os << "a\0337b\033[2Kc\033[?25ld";
+        REQUIRE(out.str() == "abcd");
+    }
+
+#if defined(OS_LINUX) || defined(OS_MAC)
+    SUBCASE("Terminals without colors still get control")
+    {
+        setControlMode(control::Auto);
+        setColorLevel(colorLevel::None);
+        pty term;
+        REQUIRE(term.name != nullptr);
+        const int slave = open(term.name, O_RDWR | O_NOCTTY);
+        ostringstream out;
+        REQUIRE(registerTerminal(out.rdbuf(), slave));
+        out << fg::red << erase::lineEnd << "x";
+        unregisterTerminal(out.rdbuf());
+        close(slave);
+        setColorLevel(colorLevel::TrueColor);
+
+        REQUIRE(out.str() == "\033[Kx");
+    }
+#endif
+}
+
+TEST_CASE("Rang tables")
+{
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+
+    SUBCASE("Columns are as wide as their text shows")
+    {
+        setControlMode(control::Force);
+        ostringstream out;
+        {
+            table t(out);
+            t.column("name").column("n", align::right);
+            t.cell("\xE6\x97\xA5\xE6\x9C\xAC").cell(fg::red, "7").endRow();
+            t.cell("\033[1mx\033[0m").cell("1234").endRow();
+            REQUIRE(out.str().empty());
+        }
+        REQUIRE(out.str()
+                == "\033[1mname\033[0m     \033[1mn\033[0m\n"
+                   "\xE6\x97\xA5\xE6\x9C\xAC     \033[31m7\033[0m\n"
+                   "\033[1mx\033[0m     1234\n");
+        setControlMode(control::Auto);
+    }
+
+    SUBCASE("Rows after the sample are streamed and cut")
+    {
+        setControlMode(control::Off);
+        ostringstream out;
+        table t(out, 1);
+        t.column("id").column("what");
+        t.cell("1").cell(fg::green, "abcd").endRow();
+        REQUIRE(out.str() == "id  what\n1   abcd\n");
+
+        t.cell("22").cell("abcdef").endRow();
+        REQUIRE(out.str() == "id  what\n1   abcd\n22  abc\xE2\x80\xA6\n");
+        setControlMode(control::Auto);
+    }
+
+    SUBCASE("Columns the sample has no text for get a fallback width")
+    {
+        setControlMode(control::Off);
+        ostringstream out;
+        table t(out, 1);
+        t.cell("a").cell("").endRow();
+        t.cell("b").cell("late").cell("much later text").endRow();
+        t.cell("c").cell("0123456789").cell("x").endRow();
+
+        REQUIRE(out.str()
+                == "a\n"
+                   "b  late      much la\xE2\x80\xA6\n"
+                   "c  0123456\xE2\x80\xA6  x\n");
+        setControlMode(control::Auto);
+    }
+
+    SUBCASE("Only the padding is trimmed")
+    {
+        setControlMode(control::Off);
+        ostringstream out;
+        {
+            table t(out);
+            t.column("k").column("v");
+            t.cell("x").cell("kept  ").endRow();
+            t.cell("y").cell("").endRow();
+        }
+
+        REQUIRE(out.str() == "k  v\nx  kept  \ny\n");
+        setControlMode(control::Auto);
+    }
+}
+
+TEST_CASE("Rang visible width")
+{
+    const char red[]  = "\033[31mred\033[0m";
+    const char wide[] = "\xE6\x97\xA5\xE6\x9C\xAC";  // 2 wide characters
+    const string line = "2024-01-01 12:00:00 \033[1;31mERROR\033[0m disk full";
+
+    SUBCASE("visibleWidth")
+    {
+        REQUIRE(visibleWidth(red, sizeof red - 1) == 3);
+        REQUIRE(visibleWidth(wide, sizeof wide - 1) == 4);
+        REQUIRE(visibleWidth("e\xCC\x81", 3) == 1);  // combining accent
+        REQUIRE(visibleWidth("a\tb\x7F", 4) == 2);
+        REQUIRE(visibleWidth("\xFF\xC3", 2) == 2);  // broken UTF-8
+        REQUIRE(visibleWidth(line.data(), line.size()) == 35);
+        REQUIRE(visibleWidth("\033]0;title\007ok", 12) == 2);
+    }
+
+    SUBCASE("truncateVisible never splits characters or escapes")
+    {
+        REQUIRE(truncateVisible(red, sizeof red - 1, 2) == 7);
+        REQUIRE(truncateVisible(red, sizeof red - 1, 3) == sizeof red - 1);
+        REQUIRE(truncateVisible(wide, sizeof wide - 1, 3) == 3);
+        REQUIRE(truncateVisible(line.data(), line.size(), 25)
+                == line.size() - 10);  // the reset after ERROR kept
+        REQUIRE(truncateVisible(line.data(), line.size(), 100) == line.size());
+    }
+
+    SUBCASE("padVisible")
+    {
+        char buf[32];
+        size_t n = padVisible(buf, sizeof buf, red, sizeof red - 1, 5);
+        REQUIRE(string(buf, n) == "\033[31mred\033[0m  ");
+        n = padVisible(buf, sizeof buf, wide, sizeof wide - 1, 6, align::right);
+        REQUIRE(string(buf, n) == "  \xE6\x97\xA5\xE6\x9C\xAC");
+        n = padVisible(buf, sizeof buf, red, sizeof red - 1, 2);
+        REQUIRE(string(buf, n) == red);
+        REQUIRE(padVisible(buf, 4, "ab", 2, 8) == 8);
+    }
+
+    SUBCASE("splitEscapes")
+    {
+        vector<string> runs;
+        splitEscapes(line.data(), line.size(),
+                     [&runs](const char *data, size_t size, bool isEscape) {
+                         runs.push_back((isEscape ? "E:" : "T:")
+                                        + string(data, size));
+                     });
+        REQUIRE(runs
+                == vector<string>{ "T:2024-01-01 12:00:00 ", "E:\033[1;31m",
+                                   "T:ERROR", "E:\033[0m", "T: disk full" });
+    }
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    SUBCASE("string_view overloads")
+    {
+        const std::string_view text = red;
+        REQUIRE(visibleWidth(text) == 3);
+        REQUIRE(truncateVisible(text, 1) == "\033[31mr");
+        char buf[16];
+        REQUIRE(padVisible(buf, sizeof buf, text, 4) == text.size() + 1);
+        size_t escapes = 0;
+        splitEscapes(text, [&escapes](std::string_view, bool isEscape) {
+            escapes += isEscape ? 1 : 0;
+        });
+        REQUIRE(escapes == 2);
+    }
+#endif
+}
+
+TEST_CASE("Rang syntax highlighting")
+{
+    // Tokens as "kind:text", kinds by their first letter
+    const auto tokens = [](const syntax lang, const string &text) {
+        string out;
+        tokenize(lang, text.data(), text.size(),
+                 [&out](const token kind, const char *data, size_t size) {
+                     static const char kinds[] = "tksnwpc";
+                     out += kinds[static_cast<size_t>(kind)];
+                     out += ':';
+                     out.append(data, size);
+                     out += '|';
+                 });
+        return out;
+    };
+
+    SUBCASE("JSON")
+    {
+        const string json = "{\"a\" : -1.5e+3, \"b\": [true, \"x\\\"\"]}";
+        REQUIRE(tokens(syntax::json, json)
+                == "p:{|k:\"a\"|t: |p::|t: |n:-1.5e+3|p:,|t: |k:\"b\"|p::|t: "
+                   "|p:[|w:true|p:,|t: |s:\"x\\\"\"|p:]}|");
+    }
+
+    SUBCASE("key=value")
+    {
+        REQUIRE(tokens(syntax::keyValue, "level=error took=3ms ok=true "
+                                          "msg=\"disk full\"")
+                == "k:level|p:=|t:error|t: |k:took|p:=|n:3ms|t: |k:ok|p:=|"
+                   "w:true|t: |k:msg|p:=|s:\"disk full\"|");
+    }
+
+    SUBCASE("C-like")
+    {
+        REQUIRE(tokens(syntax::cLike, "#include <x>\nint f() { return 0x1F; }"
+                                      " // done\n/* a\nb */ a # b")
+                == "w:#include|t: |p:<|t:x|p:>|t:\n|w:int|t: |t:f|p:()|t: "
+                   "|p:{|t: |w:return|t: |n:0x1F|p:;|t: |p:}|t: |c:// done"
+                   "|t:\n|c:/* a\nb */|t: |t:a|t: |p:#|t: |t:b|");
+    }
+
+    SUBCASE("Escapes only where the style changes")
+    {
+        setControlMode(control::Force);
+        setColorLevel(colorLevel::TrueColor);
+        setWinTermMode(winTerm::Ansi);
+        ostringstream out;
+        highlight(out, syntax::json, "{\"a\": 1}", 8);
+        REQUIRE(out.str() == "{\033[34m\"a\"\033[0m: \033[36m1\033[0m}");
+
+        theme green;
+        green.punctuation = fg::green;
+        out.str("");
+        highlight(out, syntax::json, "[\"x\"]", 5, green);
+        REQUIRE(out.str() == "\033[32m[\"x\"]\033[0m");
+
+        setControlMode(control::Off);
+        out.str("");
+        highlight(out, syntax::json, "{\"a\": 1}", 8);
+        REQUIRE(out.str() == "{\"a\": 1}");
+        setControlMode(control::Auto);
+    }
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    SUBCASE("string_view overloads")
+    {
+        size_t keys = 0;
+        tokenize(syntax::keyValue, std::string_view("a=1 b=2"),
+                 [&keys](const token kind, std::string_view) {
+                     keys += kind == token::key ? 1 : 0;
+                 });
+        REQUIRE(keys == 2);
+        setControlMode(control::Off);
+        ostringstream out;
+        highlight(out, syntax::cLike, std::string_view("int x;"));
+        REQUIRE(out.str() == "int x;");
+        setControlMode(control::Auto);
+    }
+#endif
+}
+
+namespace {
+
+// Applies a unified diff to from, to check the diffs rang writes
+string applyDiff(const string &from, const string &patch)
+{
+    vector<string> lines;
+    for (size_t p = 0; p < from.size();) {
+        const size_t nl = from.find('\n', p);
+        const size_t next = nl == string::npos ? from.size() : nl + 1;
+        lines.push_back(from.substr(p, next - p));
+        p = next;
+    }
+    istringstream in(patch);
+    string line;
+    string out;
+    size_t at     = 0;
+    bool lastPlus = false;
+    while (getline(in, line)) {
+        if (line.compare(0, 4, "--- ") == 0
+            || line.compare(0, 4, "+++ ") == 0) {
+            continue;
+        }
+        if (line.compare(0, 4, "@@ -") == 0) {
+            size_t start = stoul(line.substr(4));
+            start        = start == 0 ? 0 : start - 1;
+            if (line.find(',') < line.find(' ', 4)
+                && stoul(line.substr(line.find(',') + 1)) == 0) {
+                ++start;  // an empty range names the line before it
+            }
+            for (; at < start; ++at) {
+                out += lines[at];
+            }
+        } else if (line[0] == ' ' || line[0] == '-') {
+            out += line[0] == ' ' ? lines[at] : string();
+            ++at;
+        } else if (line[0] == '+') {
+            out += line.substr(1) + '\n';
+        } else if (line[0] == '\\' && lastPlus) {
+            out.pop_back();  // the others come from lines as they are
+        }
+        lastPlus = line[0] == '+';
+    }
+    for (; at < lines.size(); ++at) {
+        out += lines[at];
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST_CASE("Rang diff")
+{
+    setWinTermMode(winTerm::Ansi);
+    setColorLevel(colorLevel::TrueColor);
+    setControlMode(control::Off);
+
+    const auto unified = [](const string &from, const string &to,
+                            const diffOptions &options) {
+        ostringstream out;
+        diff(out, from.data(), from.size(), to.data(), to.size(), options);
+        return out.str();
+    };
+
+    SUBCASE("Unified hunks")
+    {
+        diffOptions options;
+        options.context = 1;
+        REQUIRE(unified("a\nb\nc\nd\n", "a\nB\nc\nd\ne\n", options)
+                == "--- a\n+++ b\n@@ -1,4 +1,5 @@\n a\n-b\n+B\n c\n d\n+e\n");
+        REQUIRE(unified("1\n2\n3\n4\n5\n6\n", "2\n3\n4\n5\n6\n", options)
+                == "--- a\n+++ b\n@@ -1,2 +1 @@\n-1\n 2\n");
+        REQUIRE(unified("x", "y", options)
+                == "--- a\n+++ b\n@@ -1 +1 @@\n-x\n"
+                   "\\ No newline at end of file\n+y\n"
+                   "\\ No newline at end of file\n");
+        REQUIRE(unified("", "new\n", options)
+                == "--- a\n+++ b\n@@ -0,0 +1 @@\n+new\n");
+
+        ostringstream out;
+        REQUIRE(!diff(out, "same\n", 5, "same\n", 5));
+        REQUIRE(out.str().empty());
+    }
+
+    SUBCASE("Colored lines and changed words")
+    {
+        setControlMode(control::Force);
+        const string from = "int x = 1;\nkeep\nold\n";
+        const string to   = "int x = 2;\nkeep\nnew\n";
+        REQUIRE(unified(from, to, diffOptions())
+                == "\033[1m--- a\033[0m\n\033[1m+++ b\033[0m\n"
+                   "\033[36m@@ -1,3 +1,3 @@\033[0m\n"
+                   "\033[31m-int x = \033[0m\033[41;30m1\033[0m"
+                   "\033[31m;\033[0m\n"
+                   "\033[32m+int x = \033[0m\033[42;30m2\033[0m"
+                   "\033[32m;\033[0m\n"
+                   " keep\n"
+                   "\033[31m-old\033[0m\n\033[32m+new\033[0m\n");
+        setControlMode(control::Off);
+    }
+
+    SUBCASE("Large inputs apply back")
+    {
+        std::mt19937 random(7);
+        string from;
+        string to;
+        for (int i = 0; i < 20000; ++i) {
+            const string line = "line " + to_string(random() % 50) + '\n';
+            const unsigned edit = random() % 10;
+            from += edit == 0 ? string() : line;
+            to += edit == 1 ? string() : edit == 2 ? "changed\n" : line;
+        }
+        diffOptions options;
+        options.context = 2;
+        const string patch = unified(from, to, options);
+        REQUIRE(!patch.empty());
+        REQUIRE(applyDiff(from, patch) == to);
+    }
+
+    SUBCASE("Files")
+    {
+        {
+            ofstream("diffFrom.txt") << "one\ntwo\n";
+            ofstream("diffTo.txt") << "one\n2\n";
+        }
+        ostringstream out;
+        REQUIRE(diffFiles(out, "diffFrom.txt", "diffTo.txt") == 1);
+        REQUIRE(out.str()
+                == "--- diffFrom.txt\n+++ diffTo.txt\n"
+                   "@@ -1,2 +1,2 @@\n one\n-two\n+2\n");
+        REQUIRE(diffFiles(out, "diffFrom.txt", "diffFrom.txt") == 0);
+        REQUIRE(diffFiles(out, "diffFrom.txt", "missing.txt") == 2);
+        remove("diffFrom.txt");
+        remove("diffTo.txt");
+    }
+    setControlMode(control::Auto);
+}